@@ -8,13 +8,23 @@
 #include <fstream>
 #include <cmath>
 
+#include "../common/cache_probe.h"
+#include "../common/arena.h"
+#include "../common/memstats.h"
+#include "../common/partition.h"
+#include "../common/cost_model.h"
+#include "../common/fingerprint.h"
+
 using namespace std;
 
+// Operand storage comes from the arena: huge-page slabs, recycled across sizes
+typedef vector<double, HpcArenaAllocator<double>> Matrix;
+
 inline int idx(int r, int c, int N) {
     return r * N + c;
 }
 
-double get_checksum(const vector<double>& C, int N) {
+double get_checksum(const Matrix& C, int N) {
     double sum = 0;
     int limit = min(N, 4);
     for (int i = 0; i < limit; i++) {
@@ -25,6 +35,11 @@ double get_checksum(const vector<double>& C, int N) {
     return sum;
 }
 
+// Compulsory traffic of C = A + B: two reads, one write plus write-allocate
+long long bytes_moved(int N) {
+    return 4LL * sizeof(double) * N * N;
+}
+
 enum PatternID {
     BLOCKED_32 = 0,
     COL_MAJOR = 1,
@@ -34,11 +49,14 @@ enum PatternID {
     UNROLL_4 = 5
 };
 
-void add_blocked_32(const vector<double>& A, const vector<double>& B, vector<double>& C, int N, int t_id, int n_threads) {
-    int blockSize = 32;
-    int rows_per_thread = N / n_threads;
-    int start_row = t_id * rows_per_thread;
-    int end_row = (t_id == n_threads - 1) ? N : start_row + rows_per_thread;
+// Tile edge for add_blocked_32; 32 unless the host cache probe says otherwise.
+int g_block_size = 32;
+
+void add_blocked_32(const Matrix& A, const Matrix& B, Matrix& C, int N, int t_id, int n_threads) {
+    int blockSize = g_block_size;
+    hpc_range_t rows = hpc_split(N, t_id, n_threads);
+    int start_row = (int)rows.begin;
+    int end_row = (int)rows.end;
 
     for (int ii = start_row; ii < end_row; ii += blockSize) {
         for (int jj = 0; jj < N; jj += blockSize) {
@@ -52,10 +70,11 @@ void add_blocked_32(const vector<double>& A, const vector<double>& B, vector<dou
     }
 }
 
-void add_col_major(const vector<double>& A, const vector<double>& B, vector<double>& C, int N, int t_id, int n_threads) {
-    int cols_per_thread = N / n_threads;
-    int start_col = t_id * cols_per_thread;
-    int end_col = (t_id == n_threads - 1) ? N : start_col + cols_per_thread;
+void add_col_major(const Matrix& A, const Matrix& B, Matrix& C, int N, int t_id, int n_threads) {
+    // whole 64-byte lines of every row per thread, so column seams do not share lines
+    hpc_range_t cols = hpc_split_aligned(N, sizeof(double), C.data(), 64, t_id, n_threads);
+    int start_col = (int)cols.begin;
+    int end_col = (int)cols.end;
 
     for (int j = start_col; j < end_col; j++) {
         for (int i = 0; i < N; i++) {
@@ -65,7 +84,7 @@ void add_col_major(const vector<double>& A, const vector<double>& B, vector<doub
     }
 }
 
-void add_cyclic_rows(const vector<double>& A, const vector<double>& B, vector<double>& C, int N, int t_id, int n_threads) {
+void add_cyclic_rows(const Matrix& A, const Matrix& B, Matrix& C, int N, int t_id, int n_threads) {
     for (int i = t_id; i < N; i += n_threads) {
         for (int j = 0; j < N; j++) {
             int id = idx(i, j, N);
@@ -74,20 +93,21 @@ void add_cyclic_rows(const vector<double>& A, const vector<double>& B, vector<do
     }
 }
 
-void add_linear_flat(const vector<double>& A, const vector<double>& B, vector<double>& C, int N, int t_id, int n_threads) {
+void add_linear_flat(const Matrix& A, const Matrix& B, Matrix& C, int N, int t_id, int n_threads) {
     long long total = (long long)N * N;
-    long long chunk = total / n_threads;
-    long long start = t_id * chunk;
-    long long end = (t_id == n_threads - 1) ? total : start + chunk;
+    hpc_range_t r = hpc_split_aligned(total, sizeof(double), C.data(), hpc_partition_align(),
+                                      t_id, n_threads);
+    long long start = r.begin;
+    long long end = r.end;
 
     for (long long k = start; k < end; k++) {
         C[k] = A[k] + B[k];
     }
 }
-void add_row_major_chunks(const vector<double>& A, const vector<double>& B, vector<double>& C, int N, int t_id, int n_threads) {
-    int rows_per_thread = N / n_threads;
-    int start_row = t_id * rows_per_thread;
-    int end_row = (t_id == n_threads - 1) ? N : start_row + rows_per_thread;
+void add_row_major_chunks(const Matrix& A, const Matrix& B, Matrix& C, int N, int t_id, int n_threads) {
+    hpc_range_t rows = hpc_split(N, t_id, n_threads);
+    int start_row = (int)rows.begin;
+    int end_row = (int)rows.end;
 
     for (int i = start_row; i < end_row; i++) {
         for (int j = 0; j < N; j++) {
@@ -97,10 +117,10 @@ void add_row_major_chunks(const vector<double>& A, const vector<double>& B, vect
     }
 }
 
-void add_unroll_4(const vector<double>& A, const vector<double>& B, vector<double>& C, int N, int t_id, int n_threads) {
-    int rows_per_thread = N / n_threads;
-    int start_row = t_id * rows_per_thread;
-    int end_row = (t_id == n_threads - 1) ? N : start_row + rows_per_thread;
+void add_unroll_4(const Matrix& A, const Matrix& B, Matrix& C, int N, int t_id, int n_threads) {
+    hpc_range_t rows = hpc_split(N, t_id, n_threads);
+    int start_row = (int)rows.begin;
+    int end_row = (int)rows.end;
 
     for (int i = start_row; i < end_row; i++) {
         int j = 0;
@@ -122,7 +142,7 @@ void add_unroll_4(const vector<double>& A, const vector<double>& B, vector<doubl
 }
 
 
-typedef void (*MatrixFunc)(const vector<double>&, const vector<double>&, vector<double>&, int, int, int);
+typedef void (*MatrixFunc)(const Matrix&, const Matrix&, Matrix&, int, int, int);
 
 struct PatternInfo {
     int id;
@@ -142,8 +162,16 @@ int main() {
         {UNROLL_4,        " ",          add_unroll_4}
     };
 
+    cache_info_t cache;
+    cache_probe_host(&cache);
+    cache_probe_print(stdout, &cache);
+    g_block_size = cache_tile_square(&cache, 3);
+    cout << "add_blocked_32 tile: " << g_block_size << endl;
+
     ofstream csv("results.csv");
-    csv << "N,threads,pattern,sec,checksum" << endl;
+    hpc_fingerprint_sidecar("results.csv", HPC_COMPILER_ID, HPC_CFLAGS);
+    csv << "N,threads,pattern,sec,checksum,minflt,majflt,contaminated,"
+        << "alloc_bytes,footprint_bytes,rss_peak_kb,bytes_moved,active" << endl;
 
     cout << left 
          << setw(8) << "N" 
@@ -154,26 +182,36 @@ int main() {
     cout << string(60, '-') << endl;
 
     for (int N : dimensions) {
-        vector<double> A(N * N, 1.0);
-        vector<double> B(N * N, 2.0);
-        vector<double> C(N * N, 0.0);
+        Matrix A(N * N, 1.0);
+        Matrix B(N * N, 2.0);
+        Matrix C(N * N, 0.0);
 
         for (int t_num : thread_counts) {
+            // threads that actually run: small N stays below the grain-size cutoff
+            const hpc_cost_model_t* cm = hpc_cost_model();
+            double work = hpc_cost_work_ns(cm, (double)N * N, bytes_moved(N), 3.0 * sizeof(double) * N * N);
+            int active = hpc_auto_threads(cm, work, cm->spawn_ns, t_num);
             for (const auto& p : patterns) {
-                
-                fill(C.begin(), C.end(), 0.0);
-
+                // Every pattern overwrites C, so it is not re-zeroed here;
+                // C was first-touched at construction, outside the timing
+                hpc_mem_t mem;
+                hpc_mem_begin(&mem);
+                hpc_faults_t faults;
+                hpc_faults_begin(&faults);
                 auto start = chrono::high_resolution_clock::now();
 
                 vector<thread> threads;
-                for(int t = 0; t < t_num; t++) {
-                    threads.emplace_back(p.func, ref(A), ref(B), ref(C), N, t, t_num);
+                for(int t = 0; t < active; t++) {
+                    threads.emplace_back(p.func, ref(A), ref(B), ref(C), N, t, active);
                 }
                 for(auto& th : threads) {
                     th.join();
                 }
 
                 auto end = chrono::high_resolution_clock::now();
+                hpc_faults_end(&faults);
+                hpc_mem_end(&mem);
+                bool dirty = hpc_faults_contaminated(&faults);
                 double time_sec = chrono::duration<double>(end - start).count();
                 double chk = get_checksum(C, N);
                 cout << left 
@@ -181,18 +219,23 @@ int main() {
                      << setw(10) << t_num 
                      << setw(10) << p.id 
                      << setw(15) << fixed << setprecision(9) << time_sec 
-                     << setw(15) << fixed << setprecision(6) << chk << endl;
+                     << setw(15) << fixed << setprecision(6) << chk
+                     << (dirty ? "[page faults]" : "") << endl;
 
                 csv << N << "," 
                     << t_num << "," 
                     << p.id << "," 
                     << fixed << setprecision(9) << time_sec << "," 
-                    << fixed << setprecision(6) << chk << endl;
+                    << fixed << setprecision(6) << chk << ","
+                    << faults.minflt << "," << faults.majflt << "," << dirty << ","
+                    << mem.alloc_bytes << "," << mem.footprint_bytes << ","
+                    << mem.rss_peak_kb << "," << bytes_moved(N) << "," << active << endl;
             }
         }
         cout << string(70, '-') << endl;
     }
 
     csv.close();
+    hpc_arena_print_stats(stdout);
     return 0;
 }
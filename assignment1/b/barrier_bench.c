@@ -0,0 +1,122 @@
+// Barrier latency microbenchmark: every kind from common/barriers.h at
+// 1..max threads. Each thread is pinned, then all threads run EPISODES
+// back-to-back barriers with no work in between; the time per episode is
+// the barrier's latency. Results go to stdout and barrier_results.csv.
+//
+// Usage: ./barrier_bench [max_threads] [episodes]
+// Build: gcc -O2 -pthread barrier_bench.c -o barrier_bench
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sched.h>
+
+#include "../common/barriers.h"
+
+#define EPISODES 20000
+
+typedef struct {
+    int tid;
+    int episodes;
+    hpc_barrier_t *bar;
+    pthread_barrier_t *start;
+    char pad[64];
+} bench_arg_t;
+
+static inline uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void pin_thread(int tid) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    int cores = sysconf(_SC_NPROCESSORS_ONLN);
+    CPU_SET(tid % cores, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static void *bench_worker(void *v) {
+    bench_arg_t *a = (bench_arg_t *)v;
+    pin_thread(a->tid);
+    pthread_barrier_wait(a->start);
+    for (int e = 0; e < a->episodes; e++)
+        hpc_barrier_wait(a->bar, a->tid);
+    return NULL;
+}
+
+// Nanoseconds per barrier episode, best of 3
+static double measure(hpc_barrier_kind kind, int T, int episodes) {
+    double best = 1e30;
+    for (int run = 0; run < 3; run++) {
+        hpc_barrier_t bar;
+        pthread_barrier_t start;
+        if (hpc_barrier_init(&bar, kind, T) != 0) {
+            fprintf(stderr, "barrier init failed\n");
+            exit(1);
+        }
+        pthread_barrier_init(&start, NULL, T + 1);
+
+        pthread_t ths[T];
+        bench_arg_t args[T];
+        for (int t = 0; t < T; t++) {
+            args[t].tid = t;
+            args[t].episodes = episodes;
+            args[t].bar = &bar;
+            args[t].start = &start;
+            pthread_create(&ths[t], NULL, bench_worker, &args[t]);
+        }
+        pthread_barrier_wait(&start);
+        uint64_t t0 = now_ns();
+        for (int t = 0; t < T; t++)
+            pthread_join(ths[t], NULL);
+        uint64_t t1 = now_ns();
+
+        double ns = (double)(t1 - t0) / episodes;
+        if (ns < best) best = ns;
+        pthread_barrier_destroy(&start);
+        hpc_barrier_destroy(&bar);
+    }
+    return best;
+}
+
+int main(int argc, char **argv) {
+    int max_t = argc >= 2 ? atoi(argv[1]) : 16;
+    int episodes = argc >= 3 ? atoi(argv[2]) : EPISODES;
+    int cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (max_t < 1) max_t = 1;
+
+    FILE *csv = fopen("barrier_results.csv", "w");
+    if (csv) fprintf(csv, "barrier,threads,ns_per_episode\n");
+
+    /* powers of two up to max_t, then max_t itself */
+    int counts[32], nc = 0;
+    for (int T = 1; T <= max_t && nc < 31; T *= 2) counts[nc++] = T;
+    if (counts[nc - 1] != max_t) counts[nc++] = max_t;
+
+    printf("cores=%d episodes=%d%s\n", cores, episodes,
+           max_t > cores ? "  (threads > cores: no spinning, waiters yield at once)" : "");
+    printf("%-8s", "threads");
+    for (int k = 0; k < HPC_BAR_KINDS; k++) printf("%12s", hpc_barrier_names[k]);
+    printf("%8s   (ns per episode)\n", "spin");
+
+    for (int c = 0; c < nc; c++) {
+        int T = counts[c];
+        printf("%-8d", T);
+        for (int k = 0; k < HPC_BAR_KINDS; k++) {
+            double ns = measure((hpc_barrier_kind)k, T, episodes);
+            printf("%12.1f", ns);
+            fflush(stdout);
+            if (csv) fprintf(csv, "%s,%d,%.1f\n", hpc_barrier_names[k], T, ns);
+        }
+        printf("%8d\n", hpc_barrier_spin(T));   /* spin budget the barriers used at T */
+    }
+    if (csv) fclose(csv);
+    printf("Results written to barrier_results.csv\n");
+    return 0;
+}
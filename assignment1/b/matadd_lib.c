@@ -0,0 +1,81 @@
+/*
+ * matadd_lib.c - matadd.c's benchmark on libhpcmat's persistent pool
+ *
+ * Same arguments and CSV as matadd.c, but the additions run through
+ * hpc_add: the T threads are started once and parked between repeats, and
+ * the library's cutoff (charged the pool's dispatch cost, not a spawn)
+ * picks how many of them run. matadd.c stays the spawn-per-repeat
+ * baseline that results.csv measures.
+ *
+ * Build:
+ *   ../lib/build.sh
+ *   gcc -O3 -march=native matadd_lib.c ../lib/libhpcmat.a -o matadd_lib -lm -pthread
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "../common/cache_probe.h"
+#include "../common/arena.h"
+#include "../common/memstats.h"
+#include "../common/rapl.h"
+#include "../common/cpufreq.h"
+#include "../lib/hpcmat.h"
+
+static inline uint64_t now_ns(){ struct timespec ts; clock_gettime(CLOCK_MONOTONIC,&ts); return (uint64_t)ts.tv_sec*1000000000ULL + ts.tv_nsec; }
+
+// patterns are lib/hpcmat.c's hpc_add ones: 0=row 1=col 2=block 3=linear 4=cyclic 5=unroll
+int main(int argc,char **argv){
+    if(argc<4){ printf("Usage: %s N nthreads pattern\nPatterns: 0=row,1=col,2=block,3=linear,4=cyclic,5=unroll\n",argv[0]); return 1; }
+    int N=atoi(argv[1]); int T=atoi(argv[2]); int pat=atoi(argv[3]); int repeats=3;
+    // clock counters first: inherited counts only follow threads created after them, and the pool starts below
+    hpc_freq_counters();
+    if(pat<HPC_ADD_ROW || pat>HPC_ADD_UNROLL4){ fprintf(stderr,"pattern must be 0..5\n"); return 1; }
+    int cores = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t total = (size_t)N*N;
+    double moved = 4.0*sizeof(double)*total; // A,B read + C write + write-allocate
+    // pool of T threads; each call runs on as many as the cutoff keeps
+    hpc_ctx_t *ctx = hpc_ctx_create(T, 0);
+    if(!ctx){ fprintf(stderr,"hpc_ctx_create: %s\n",hpc_strerror(HPC_ENOMEM)); return 1; }
+    int bsz = hpc_ctx_param(ctx, HPC_PARAM_ADD_TILE);
+    // allocate aligned (arena: 64B-aligned, huge-page slabs)
+    double *A=hpc_alloc(total*sizeof(double)), *B=hpc_alloc(total*sizeof(double)), *C=hpc_alloc(total*sizeof(double));
+    if(!A || !B || !C){ perror("hpc_alloc"); return 1; }
+    // init
+    for(size_t i=0;i<total;i++){ A[i]=1.0; B[i]=2.0; C[i]=0.0; }
+
+    // warmup
+    hpc_add(ctx,pat,N,N,A,N,B,N,C,N);
+    int active = hpc_ctx_param(ctx, HPC_PARAM_LAST_THREADS);
+    printf("N=%d threads=%d active=%d pattern=%d cores=%d block=%d dispatch_ns=%d\n",N,T,active,pat,cores,bsz,
+           hpc_ctx_param(ctx, HPC_PARAM_DISPATCH_NS));
+
+    hpc_mem_t mem; hpc_mem_begin(&mem);
+    hpc_faults_t faults; hpc_faults_begin(&faults);
+    hpc_energy_t energy; hpc_energy_begin(&energy);
+    hpc_freq_t freq; hpc_freq_begin(&freq);
+    uint64_t t0=now_ns();
+    for(int rep=0; rep<repeats; rep++) hpc_add(ctx,pat,N,N,A,N,B,N,C,N);
+    uint64_t t1=now_ns();
+    hpc_freq_end(&freq);
+    hpc_energy_end(&energy);
+    hpc_faults_end(&faults); hpc_mem_end(&mem); int dirty=hpc_faults_contaminated(&faults);
+    double elapsed = (t1 - t0)/1e9 / repeats;
+    // verify simple checksum
+    double s=0; for(size_t i=0;i<total;i+= (total/16>0?total/16:1)) s+=C[i];
+    printf("elapsed=%f sec checksum=%f minflt=%ld majflt=%ld%s\n", elapsed, s, faults.minflt, faults.majflt, dirty?" (contaminated)":"");
+    fflush(stdout);
+    // print CSV line
+    double joules = hpc_energy_joules(&energy)/repeats; // per repeat like elapsed; nan without RAPL
+    double cycles = freq.total_cycles/repeats; // all threads, per repeat; nan without a clock source
+    printf("CSV,%d,%d,%d,%.9f,%f,%ld,%ld,%d,%llu,%llu,%ld,%.0f,%d,%.6f,%.6f,%.3f,%.4f,%.3f,%.0f,%.4f,%s\n", N,T,pat,elapsed,s,faults.minflt,faults.majflt,dirty,
+           (unsigned long long)mem.alloc_bytes,(unsigned long long)mem.footprint_bytes,mem.rss_peak_kb,moved,active,
+           energy.pkg_j/repeats,energy.dram_j/repeats,joules/elapsed,moved/1e9/joules,
+           freq.ghz,cycles,cycles/total,hpc_freq_sources[freq.source]);
+    hpc_ctx_destroy(ctx);
+    hpc_arena_print_stats(stderr);
+    return 0;
+}
@@ -7,6 +7,18 @@
 #include <unistd.h>
 #include <sched.h>
 
+#include "../common/cache_probe.h"
+#include "../common/arena.h"
+#include "../common/memstats.h"
+#include "../common/partition.h"
+#include "../common/barriers.h"
+#include "../common/cost_model.h"
+#include "../common/antagonist.h"
+#include "../common/rapl.h"
+#include "../common/cpufreq.h"
+#include "../common/hdr_hist.h"
+#include "../common/perf_model.h"
+
 typedef struct {
     int N;
     int tid;
@@ -17,7 +29,11 @@ typedef struct {
     double *restrict A;
     double *restrict B;
     double *restrict C;
-    pthread_barrier_t *barrier;
+    hpc_barrier_t *barrier;
+    pthread_barrier_t *start;   // workers + main: everyone starts together
+    uint64_t t_start, t_end;    // this worker's timed span
+    hpc_hist_t *iter_hist;      // repeat latency, barrier to barrier (tid 0)
+    hpc_hist_t *work_hist;      // each worker's kernel time per repeat
     char pad[64];   // avoid false sharing
 } arg_t;
 
@@ -49,17 +65,22 @@ void *worker(void *v) {
     double *restrict B = a->B;
     double *restrict C = a->C;
 
-    pthread_barrier_t *bar = a->barrier;
+    hpc_barrier_t *bar = a->barrier;
 
-    /* synchronize start */
-    pthread_barrier_wait(bar);
+    /* synchronize start. Each worker times its own span: on an
+     * oversubscribed core a worker can run to completion before main is
+     * scheduled again, so a timer in main would miss the work */
+    pthread_barrier_wait(a->start);
+    a->t_start = now_ns();
+    uint64_t t_iter = a->t_start;
 
     for (int rep = 0; rep < a->repeats; rep++) {
+        uint64_t t_work = now_ns();
 
         if (p == 0) { /* row contiguous */
-            int rows = (N + T - 1) / T;
-            int r0 = tid * rows;
-            int r1 = r0 + rows; if (r1 > N) r1 = N;
+            hpc_range_t rows = hpc_split(N, tid, T);
+            int r0 = (int)rows.begin;
+            int r1 = (int)rows.end;
 
             for (int i = r0; i < r1; i++) {
                 double *ar = A + (size_t)i * N;
@@ -70,9 +91,10 @@ void *worker(void *v) {
             }
 
         } else if (p == 1) { /* column major */
-            int cols = (N + T - 1) / T;
-            int c0 = tid * cols;
-            int c1 = c0 + cols; if (c1 > N) c1 = N;
+            /* column seams on 64-byte lines: no line shared between threads */
+            hpc_range_t cols = hpc_split_aligned(N, sizeof(double), C, 64, tid, T);
+            int c0 = (int)cols.begin;
+            int c1 = (int)cols.end;
 
             for (int j = c0; j < c1; j++) {
                 size_t idx = j;
@@ -83,9 +105,9 @@ void *worker(void *v) {
             }
 
         } else if (p == 2) { /* blocked */
-            int rows = (N + T - 1) / T;
-            int r0 = tid * rows;
-            int r1 = r0 + rows; if (r1 > N) r1 = N;
+            hpc_range_t rows = hpc_split(N, tid, T);
+            int r0 = (int)rows.begin;
+            int r1 = (int)rows.end;
 
             for (int ii = r0; ii < r1; ii += bsz) {
                 int ie = ii + bsz; if (ie > r1) ie = r1;
@@ -103,9 +125,9 @@ void *worker(void *v) {
 
         } else if (p == 3) { /* linear */
             size_t total = (size_t)N * N;
-            size_t per = (total + T - 1) / T;
-            size_t s = tid * per;
-            size_t e = s + per; if (e > total) e = total;
+            hpc_range_t r = hpc_split_aligned(total, sizeof(double), C, hpc_partition_align(), tid, T);
+            size_t s = r.begin;
+            size_t e = r.end;
 
             for (size_t k = s; k < e; k++)
                 C[k] = A[k] + B[k];
@@ -120,9 +142,9 @@ void *worker(void *v) {
             }
 
         } else if (p == 5) { /* unroll 4 */
-            int rows = (N + T - 1) / T;
-            int r0 = tid * rows;
-            int r1 = r0 + rows; if (r1 > N) r1 = N;
+            hpc_range_t rows = hpc_split(N, tid, T);
+            int r0 = (int)rows.begin;
+            int r1 = (int)rows.end;
 
             for (int i = r0; i < r1; i++) {
                 double *ar = A + (size_t)i * N;
@@ -140,15 +162,45 @@ void *worker(void *v) {
             }
         }
 
-        pthread_barrier_wait(bar);  // end of this iteration
+        hpc_hist_record(a->work_hist, now_ns() - t_work);
+        hpc_barrier_wait(bar, tid);  // end of this iteration
+        if (tid == 0) {
+            uint64_t t = now_ns();
+            hpc_hist_record(a->iter_hist, t - t_iter);
+            t_iter = t;
+        }
     }
 
+    a->t_end = now_ns();
     return NULL;
 }
 
+/* Workers park on the start gate, so creating them (stack faults and
+ * all) stays outside the caller's measured region */
+static void spawn_workers(arg_t *args, pthread_t *ths, int active) {
+    for (int t = 0; t < active; t++)
+        pthread_create(&ths[t], NULL, worker, &args[t]);
+}
+
+/* Release spawned workers together and return the seconds per repeat:
+ * earliest worker start to latest worker end */
+static double run_workers(arg_t *args, pthread_t *ths, int active, pthread_barrier_t *start) {
+    pthread_barrier_wait(start);
+    for (int t = 0; t < active; t++)
+        pthread_join(ths[t], NULL);
+    uint64_t t0 = args[0].t_start, t1 = args[0].t_end;
+    for (int t = 1; t < active; t++) {
+        if (args[t].t_start < t0) t0 = args[t].t_start;
+        if (args[t].t_end > t1) t1 = args[t].t_end;
+    }
+    return (t1 - t0) / 1e9 / args[0].repeats;
+}
+
 int main(int argc, char **argv) {
     if (argc < 5) {
-        printf("Usage: %s N threads pattern repeats\n", argv[0]);
+        printf("Usage: %s N threads pattern repeats [barrier] [antagonists]\n", argv[0]);
+        printf("Barriers: pthread sense tree dissem hybrid (default hybrid)\n");
+        printf("Antagonists: kind@cpus,... with kind bw cache spin, e.g. bw@1,spin@2-3 (default none)\n");
         return 1;
     }
 
@@ -156,14 +208,43 @@ int main(int argc, char **argv) {
     int T = atoi(argv[2]);
     int pattern = atoi(argv[3]);
     int repeats = atoi(argv[4]);
+    hpc_barrier_kind bar_kind = hpc_barrier_parse(argc >= 6 ? argv[5] : "hybrid");
+    if (bar_kind == HPC_BAR_KINDS) {
+        fprintf(stderr, "unknown barrier %s\n", argv[5]);
+        return 1;
+    }
+    hpc_antagonists_t noise;
+    if (hpc_antagonists_parse(&noise, argc >= 7 ? argv[6] : "none") != 0) {
+        fprintf(stderr, "bad antagonist spec %s\n", argv[6]);
+        return 1;
+    }
+    char noise_desc[256];
+    hpc_antagonists_describe(&noise, noise_desc, sizeof(noise_desc));
+
+    /* open the clock counters now: inherited counts only follow threads
+     * created after them, and the workers are spawned before the region */
+    hpc_freq_counters();
 
     size_t total = (size_t)N * N;
 
-    double *A, *B, *C;
-    if (posix_memalign((void**)&A, 64, total * sizeof(double)) ||
-        posix_memalign((void**)&B, 64, total * sizeof(double)) ||
-        posix_memalign((void**)&C, 64, total * sizeof(double))) {
-        perror("posix_memalign");
+    /* tile edge for pattern 2 from the measured L1, not a fixed 32 */
+    cache_info_t cache;
+    cache_probe_host(&cache);
+    int block = cache_tile_square(&cache, 3);
+
+    /* threads are spawned once and meet at a barrier every repeat, so one
+     * more thread costs its share of the spawn plus a barrier episode */
+    double moved = 4.0 * sizeof(double) * total;   /* A, B read, C written plus write-allocate */
+    const hpc_cost_model_t *cm = hpc_cost_model();
+    double work = hpc_cost_work_ns(cm, (double)total, moved, 3.0 * sizeof(double) * total);
+    double per_thread_ns = cm->spawn_ns / (repeats > 0 ? repeats : 1) + cm->barrier_ns;
+    int active = hpc_auto_threads(cm, work, per_thread_ns, T);
+
+    double *A = hpc_alloc(total * sizeof(double));
+    double *B = hpc_alloc(total * sizeof(double));
+    double *C = hpc_alloc(total * sizeof(double));
+    if (!A || !B || !C) {
+        perror("hpc_alloc");
         return 1;
     }
 
@@ -173,38 +254,123 @@ int main(int argc, char **argv) {
         C[i] = 0.0;
     }
 
-    pthread_t *ths = malloc(sizeof(pthread_t) * T);
-    arg_t *args = malloc(sizeof(arg_t) * T);
+    pthread_t *ths = hpc_alloc(sizeof(pthread_t) * T);
+    arg_t *args = hpc_alloc(sizeof(arg_t) * T);
 
-    pthread_barrier_t barrier;
-    pthread_barrier_init(&barrier, NULL, T);
+    hpc_barrier_t barrier;
+    if (hpc_barrier_init(&barrier, bar_kind, active) != 0) {
+        perror("hpc_barrier_init");
+        return 1;
+    }
+    pthread_barrier_t start;
+    pthread_barrier_init(&start, NULL, active + 1);
+    hpc_hist_t *iter_hist = hpc_alloc(sizeof(hpc_hist_t));
+    hpc_hist_t *work_hist = hpc_alloc(sizeof(hpc_hist_t));
 
-    for (int t = 0; t < T; t++) {
+    for (int t = 0; t < active; t++) {
         args[t].N = N;
         args[t].tid = t;
-        args[t].nthreads = T;
+        args[t].nthreads = active;
         args[t].pattern = pattern;
-        args[t].block = 32;
+        args[t].block = block;
         args[t].repeats = repeats;
         args[t].A = A;
         args[t].B = B;
         args[t].C = C;
         args[t].barrier = &barrier;
-        pthread_create(&ths[t], NULL, worker, &args[t]);
+        args[t].start = &start;
+        args[t].iter_hist = iter_hist;
+        args[t].work_hist = work_hist;
     }
 
-    uint64_t t0 = now_ns();
-    for (int t = 0; t < T; t++)
-        pthread_join(ths[t], NULL);
-    uint64_t t1 = now_ns();
+    /* with antagonists: an idle-machine run first, then the reported run
+     * under noise; slowdown = noisy / quiet */
+    double quiet = 0.0;
+    if (noise.n) {
+        spawn_workers(args, ths, active);
+        quiet = run_workers(args, ths, active, &start);
+        if (hpc_antagonists_start(&noise) != 0) {
+            perror("hpc_antagonists_start");
+            return 1;
+        }
+    }
 
-    double sec = (t1 - t0) / 1e9 / repeats;
+    /* reset outside the measured region: it touches the counts' pages */
+    hpc_hist_reset(iter_hist);
+    hpc_hist_reset(work_hist);
+    spawn_workers(args, ths, active);
+    hpc_mem_t mem;
+    hpc_mem_begin(&mem);
+    hpc_faults_t faults;
+    hpc_faults_begin(&faults);
+    hpc_energy_t energy;
+    hpc_energy_begin(&energy);
+    hpc_freq_t freq;
+    hpc_freq_begin(&freq);
+    double sec = run_workers(args, ths, active, &start);
+    hpc_freq_end(&freq);
+    hpc_energy_end(&energy);
+    hpc_faults_end(&faults);
+    hpc_mem_end(&mem);
+    if (noise.n) {
+        unsigned long long ops = hpc_antagonists_stop(&noise);
+        fprintf(stderr, "antagonists %s: %llu ops, slowdown %.2fx\n", noise_desc, ops, sec / quiet);
+    } else {
+        quiet = sec;
+    }
+    int dirty = hpc_faults_contaminated(&faults);
+    if (dirty)
+        fprintf(stderr, "warning: %ld minor / %ld major page faults in timed region\n",
+                faults.minflt, faults.majflt);
 
     double checksum = 0.0;
     for (size_t i = 0; i < total; i += (total / 16 + 1))
         checksum += C[i];
 
-    printf("CSV,%d,%d,%d,%.9f,%f\n", N, T, pattern, sec, checksum);
+    /* every repeat's latency: percentiles here, the whole distribution
+     * in HPC_HIST_DIR/N<N>_T<T>_P<pattern>.{iter,work}.hgrm when set */
+    const char *hist_dir = getenv("HPC_HIST_DIR");
+    if (hist_dir && *hist_dir) {
+        const char *names[2] = {"iter", "work"};
+        hpc_hist_t *hists[2] = {iter_hist, work_hist};
+        for (int k = 0; k < 2; k++) {
+            char path[512];
+            snprintf(path, sizeof(path), "%s/N%d_T%d_P%d.%s.hgrm", hist_dir, N, T, pattern, names[k]);
+            FILE *f = fopen(path, "w");
+            if (!f) {
+                perror(path);
+                continue;
+            }
+            hpc_hist_write(hists[k], f, 1e3);
+            fclose(f);
+        }
+    }
+
+    /* what the traffic model expected per repeat; every pattern but 1
+     * sweeps rows, tiled (2), flat (3), cyclic (4) or unrolled (5) */
+    hpc_pm_shape_t shape = hpc_pm_shape_add(pattern);
+    double predicted = hpc_pm_predict_ns(&shape, N, active, per_thread_ns) / 1e9;
+    if (hpc_pm_deviates(sec, predicted, 2.0))
+        fprintf(stderr, "model: N=%d T=%d pattern %d took %.2fx the predicted %.6fs\n",
+                N, T, pattern, sec / predicted, predicted);
+
+    /* energy per repeat, like sec; nan without RAPL */
+    double joules = hpc_energy_joules(&energy) / repeats;
+    /* cycles of all workers per repeat: comparable across clocks */
+    double cycles = freq.total_cycles / repeats;
+    printf("CSV,%d,%d,%d,%.9f,%f,%ld,%ld,%d,%llu,%llu,%ld,%.0f,%s,%d,%s,%.9f,%.4f,%.6f,%.6f,%.3f,%.4f,"
+           "%.3f,%.0f,%.4f,%s,%.3f,%.3f,%.3f,%.3f,%.3f,%.9f,%.3f\n",
+           N, T, pattern, sec, checksum, faults.minflt, faults.majflt, dirty,
+           (unsigned long long)mem.alloc_bytes, (unsigned long long)mem.footprint_bytes, mem.rss_peak_kb,
+           moved, hpc_barrier_names[bar_kind], active, noise_desc, quiet, sec / quiet,
+           energy.pkg_j / repeats, energy.dram_j / repeats, joules / sec, moved / 1e9 / joules,
+           freq.ghz, cycles, cycles / total, hpc_freq_sources[freq.source],
+           hpc_hist_percentile(iter_hist, 50) / 1e3, hpc_hist_percentile(iter_hist, 99) / 1e3,
+           hpc_hist_percentile(iter_hist, 99.9) / 1e3, (double)iter_hist->max / 1e3,
+           hpc_hist_percentile(work_hist, 99) / 1e3, predicted, sec / predicted);
+    hpc_barrier_destroy(&barrier);
+    pthread_barrier_destroy(&start);
+    hpc_arena_print_stats(stderr);
 
     return 0;
 }
@@ -73,3 +73,55 @@ for N in Ns:
         plt.close()
 
 print("Histogram plots saved in ./assets/histograms/")
+
+# --------- LATENCY DISTRIBUTIONS ----------
+# Per-repeat latencies recorded in-process by optimized_matadd
+# (common/hdr_hist.h, written to hist/ by run_benchmarks.sh): latency
+# against percentile on the usual 1/(1-p) axis, so the tail is visible
+hist_dir = os.environ.get("HPC_HIST_DIR", "hist")
+latency_dir = "./assets/latency"
+
+
+def read_hgrm(path):
+    values, inv = [], []
+    with open(path) as f:
+        for line in f:
+            parts = line.split()
+            if len(parts) == 4 and not line.startswith("#") and parts[0] != "Value":
+                values.append(float(parts[0]))
+                inv.append(float(parts[3]))
+    return values, inv
+
+
+if os.path.isdir(hist_dir):
+    os.makedirs(latency_dir, exist_ok=True)
+    for N in Ns:
+        for pid, pattern in pattern_names.items():
+            files = sorted(
+                f for f in os.listdir(hist_dir)
+                if f.startswith(f"N{N}_T") and f.endswith(f"_P{pid}.iter.hgrm")
+            )
+            if not files:
+                continue
+
+            plt.figure(figsize=(7, 4))
+            for name in sorted(files, key=lambda f: int(f.split("_T")[1].split("_")[0])):
+                values, inv = read_hgrm(os.path.join(hist_dir, name))
+                if values:
+                    T = name.split("_T")[1].split("_")[0]
+                    plt.plot(inv, values, label=f"{T} threads")
+
+            plt.xscale("log")
+            ticks = [1, 2, 10, 100, 1000, 10000]
+            plt.xticks(ticks, ["0%", "50%", "90%", "99%", "99.9%", "99.99%"])
+            plt.xlabel("Percentile")
+            plt.ylabel("Latency per repeat (us)")
+            plt.title(f"Latency distribution: N={N}, Pattern={pattern}")
+            plt.legend()
+            plt.grid(True, linestyle="--", alpha=0.4)
+            plt.tight_layout()
+
+            plt.savefig(f"{latency_dir}/latency_N{N}_{pattern}.png")
+            plt.close()
+
+    print("Latency distribution plots saved in ./assets/latency/")
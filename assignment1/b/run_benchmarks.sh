@@ -6,6 +6,7 @@ set -e
 ############################
 CC=gcc
 CFLAGS="-O3 -pthread -march=native"
+LDLIBS="-lm"
 BIN=matadd_opt
 OUT=results_optimized.csv
 
@@ -18,8 +19,20 @@ THREADS=(1 2 4 8 16)
 # patterns to test
 PATTERNS=(0 1 2 3 4 5)
 
-# repeats inside program
-REPEATS=5
+# repeats inside program; every repeat's latency goes into the HDR
+# histograms (common/hdr_hist.h), so raise it for stable tail percentiles
+REPEATS=${REPEATS:-5}
+
+# per-configuration latency distributions, N<N>_T<T>_P<p>.{iter,work}.hgrm
+export HPC_HIST_DIR=${HPC_HIST_DIR:-hist}
+mkdir -p "$HPC_HIST_DIR"
+
+# barrier between repeats: pthread sense tree dissem hybrid
+BARRIER=${BARRIER:-hybrid}
+
+# background noise while timing (see run_interference.sh): none, or
+# kind@cpus,... with kind bw cache spin
+ANTAGONISTS=${ANTAGONISTS:-none}
 
 # enable perf? (0/1)
 USE_PERF=0
@@ -28,12 +41,19 @@ USE_PERF=0
 # BUILD
 ############################
 echo "Compiling optimized binary..."
-$CC $CFLAGS optimized_matadd.c -o $BIN
+$CC $CFLAGS optimized_matadd.c -o $BIN $LDLIBS
 
 ############################
 # CSV HEADER
 ############################
-echo "N,threads,pattern,sec,checksum" > $OUT
+echo "N,threads,pattern,sec,checksum,minflt,majflt,contaminated,alloc_bytes,footprint_bytes,rss_peak_kb,bytes_moved,barrier,active,antagonists,quiet_sec,slowdown,pkg_joules,dram_joules,watts,gb_per_joule,ghz,cycles,cycles_per_elem,freq_src,p50_us,p99_us,p999_us,max_us,work_p99_us,predicted_sec,model_ratio" > $OUT
+
+############################
+# ENVIRONMENT
+############################
+# OUT.meta.json: CPU, SMT, governor, THP, compiler and flags of this run
+gcc -O2 ../common/fingerprint.c -o fingerprint
+./fingerprint $OUT "$CC" "$CFLAGS"
 
 ############################
 # RUN BENCHMARKS
@@ -50,11 +70,11 @@ for T in "${THREADS[@]}"; do
       if [[ $USE_PERF -eq 1 ]]; then
         perf stat -x, \
           -e cycles,instructions,cache-references,cache-misses,LLC-loads,LLC-load-misses \
-          ./$BIN $N $T $P $REPEATS \
+          ./$BIN $N $T $P $REPEATS $BARRIER "$ANTAGONISTS" \
           2>> perf_T${T}_N${N}_P${P}.csv \
           | grep "^CSV" | sed 's/^CSV,//' >> $OUT
       else
-        ./$BIN $N $T $P $REPEATS \
+        ./$BIN $N $T $P $REPEATS $BARRIER "$ANTAGONISTS" \
           | grep "^CSV" | sed 's/^CSV,//' >> $OUT
       fi
 
@@ -62,9 +82,80 @@ for T in "${THREADS[@]}"; do
   done
 done
 
+############################
+# WEAK SCALING (optional)
+############################
+# WEAK=1 also runs with N growing as BASE_N * sqrt(T), so every thread
+# keeps BASE_N^2 elements (for an add, constant work and constant memory
+# per thread are the same thing). weak_eff is per-thread throughput
+# relative to one thread: (N^2 / T / sec) / (N_1^2 / sec_1). The cost
+# model's thread cutoff is off here, every requested thread runs.
+if [[ "$WEAK" == "1" ]]; then
+  WEAK_OUT=results_weak.csv
+  BASE_N=${BASE_N:-1024}
+  RAW=$(mktemp)
+  WEAK_HIST=$HPC_HIST_DIR/weak
+  mkdir -p $WEAK_HIST
+  echo "==== WEAK SCALING, BASE_N = $BASE_N ===="
+  for P in "${PATTERNS[@]}"; do
+    for T in "${THREADS[@]}"; do
+      N=$(awk -v b=$BASE_N -v t=$T 'BEGIN { n = int(b * sqrt(t) / 8 + 0.5) * 8; print (n < 8 ? 8 : n) }')
+      echo "    pattern = $P  threads = $T  N = $N"
+      HPC_AUTO_THREADS=0 HPC_HIST_DIR=$WEAK_HIST ./$BIN $N $T $P $REPEATS $BARRIER "$ANTAGONISTS" \
+        | grep "^CSV" | sed 's/^CSV,//' >> $RAW
+    done
+  done
+  echo "N,threads,pattern,sec,checksum,minflt,majflt,contaminated,alloc_bytes,footprint_bytes,rss_peak_kb,bytes_moved,barrier,active,antagonists,quiet_sec,slowdown,pkg_joules,dram_joules,watts,gb_per_joule,ghz,cycles,cycles_per_elem,freq_src,p50_us,p99_us,p999_us,max_us,work_p99_us,predicted_sec,model_ratio,base_N,weak_eff" > $WEAK_OUT
+  awk -F, -v OFS=, -v b=$BASE_N '
+    NR == FNR { if ($2 == 1) rate1[$3] = $1 * $1 / $4; next }
+    { eff = ($3 in rate1) ? ($1 * $1 / $2 / $4) / rate1[$3] : 0; print $0, b, sprintf("%.4f", eff) }
+  ' $RAW $RAW >> $WEAK_OUT
+  rm -f $RAW
+  echo "Weak scaling written to $WEAK_OUT"
+fi
+
+############################
+# THREADS BY ENERGY
+############################
+# For power-capped racks: per N and pattern, the thread count with the
+# fewest joules per repeat next to the fastest one (needs readable RAPL
+# counters, see common/rapl.h; otherwise the energy columns are nan)
+if awk -F, 'NR > 1 && $18 != "nan" { found = 1 } END { exit !found }' $OUT; then
+  echo
+  echo "N     pattern  fastest_T  min_energy_T  joules(fastest)  joules(min)"
+  awk -F, 'NR > 1 && $18 != "nan" {
+             j = $18 + ($19 == "nan" ? 0 : $19); k = $1 "," $3
+             if (!(k in bt) || $4 < bt[k]) { bt[k] = $4; ft[k] = $2; fj[k] = j }
+             if (!(k in bj) || j < bj[k]) { bj[k] = j; et[k] = $2 }
+           }
+           END { for (k in bt) { split(k, p, ","); printf "%-5s %-8s %-10s %-13s %-16.6f %.6f\n", p[1], p[2], ft[k], et[k], fj[k], bj[k] } }' $OUT | sort -n -k1 -k2
+fi
+
+############################
+# MODEL CHECK
+############################
+# Configurations more than 2x off the cache-traffic model's prediction
+# (common/perf_model.h): the pattern does something the model does not
+echo
+echo "Model check (measured / predicted outside 0.5-2):"
+awk -F, 'NR > 1 { n++ } NR > 1 && ($32 > 2 || $32 < 0.5) {
+           bad++; printf "  N=%-5s T=%-3s pattern %s  %.2fx of %.6fs\n", $1, $2, $3, $32, $31
+         }
+         END { printf "  %d of %d configurations deviate\n", bad, n }' $OUT
+
 echo
 echo "======================================"
 echo "Benchmark complete."
 echo "Results written to $OUT"
 echo "Run: python plot_result.py"
 echo "======================================"
+
+############################
+# REGRESSION GATE (optional)
+############################
+# BASELINE=old_results.csv ./run_benchmarks.sh exits non-zero when any
+# configuration is slower than the baseline beyond the threshold
+if [[ -n "$BASELINE" ]]; then
+  g++ -O2 ../common/bench_compare.cpp -o bench_compare
+  ./bench_compare "$BASELINE" $OUT
+fi
@@ -0,0 +1,63 @@
+#!/usr/bin/env bash
+set -e
+
+############################
+# CONFIGURATION
+############################
+# Every pattern is timed on an idle machine and again next to each
+# antagonist set (common/antagonist.h); slowdown = noisy / quiet time.
+# Antagonist cores default to the ones after the kernel's threads, so the
+# two compete for shared cache and memory bandwidth but not for a core;
+# set ANTAGONIST_SETS to place them elsewhere (e.g. "spin@0" shares core 0).
+CC=gcc
+CFLAGS="-O3 -pthread -march=native"
+LDLIBS="-lm"
+BIN=matadd_opt
+OUT=results_interference.csv
+
+N=${N:-2048}
+T=${T:-4}
+PATTERNS=(0 1 2 3 4 5)
+REPEATS=5
+BARRIER=${BARRIER:-hybrid}
+
+CORES=$(nproc)
+A0=$(( T % CORES ))
+A1=$(( (T + 1) % CORES ))
+ANTAGONIST_SETS=${ANTAGONIST_SETS:-"bw@$A0 cache@$A0 spin@$A0 bw@$A0,cache@$A1"}
+
+############################
+# BUILD
+############################
+echo "Compiling optimized binary..."
+$CC $CFLAGS optimized_matadd.c -o $BIN $LDLIBS
+
+############################
+# RUN
+############################
+echo "N,threads,pattern,sec,checksum,minflt,majflt,contaminated,alloc_bytes,footprint_bytes,rss_peak_kb,bytes_moved,barrier,active,antagonists,quiet_sec,slowdown,pkg_joules,dram_joules,watts,gb_per_joule,ghz,cycles,cycles_per_elem,freq_src,p50_us,p99_us,p999_us,max_us,work_p99_us,predicted_sec,model_ratio" > $OUT
+gcc -O2 ../common/fingerprint.c -o fingerprint
+./fingerprint $OUT "$CC" "$CFLAGS"
+
+# latency distributions per antagonist set: hist_interference/<set>/
+for SET in $ANTAGONIST_SETS; do
+  echo "==== ANTAGONISTS = $SET ===="
+  export HPC_HIST_DIR=hist_interference/${SET//[,@]/_}
+  mkdir -p $HPC_HIST_DIR
+  for P in "${PATTERNS[@]}"; do
+    ./$BIN $N $T $P $REPEATS $BARRIER "$SET" 2>/dev/null \
+      | grep "^CSV" | sed 's/^CSV,//' >> $OUT
+  done
+done
+
+############################
+# SUMMARY
+############################
+# worst slowdown per pattern: the patterns that degrade gracefully first
+echo
+echo "pattern  worst_slowdown  under"
+awk -F, 'NR > 1 { if ($17 > worst[$3]) { worst[$3] = $17; by[$3] = $15 } }
+         END { for (p in worst) printf "%-8s %-15.2f %s\n", p, worst[p], by[p] }' $OUT | sort -k2 -n
+
+echo
+echo "Results written to $OUT"
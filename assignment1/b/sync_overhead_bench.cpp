@@ -0,0 +1,417 @@
+/**
+ * Thread Launch and Synchronization Overhead Suite
+ *
+ * Quantifies the fixed costs that make small kernels slower with more
+ * threads (the 1 -> 16 thread regression of matadd.c at N=256):
+ *
+ *   pthread     pthread_create + pthread_join of T empty threads
+ *   std_thread  std::thread construct + join of T empty threads
+ *   pool_cv     dispatch one empty task to a persistent pool of T workers
+ *               (mutex + condition variable) and wait for all to finish
+ *   pool_spin   same with a generation counter the workers spin on
+ *   cv_wake     condition-variable ping-pong between two threads
+ *   futex_wake  raw futex ping-pong between two threads
+ *   spin        atomic-flag ping-pong between two threads
+ *
+ * Ping-pong tests report one-way latency (round trip / 2) for three
+ * placements: unpinned, both threads on one core, threads on two cores.
+ * T-thread tests run unpinned and pinned (thread t on core t % cores).
+ *
+ * Finally the measured dispatch costs are turned into the smallest N for
+ * which an N x N add on T threads can beat one thread:
+ *   N^2 * t_elem * (1 - 1/T) > overhead(T)
+ * with t_elem the single-thread time per element ("never" when T threads
+ * share fewer than two cores).
+ *
+ * USAGE: ./sync_overhead_bench [max_threads]
+ * Build: g++ -O2 -pthread sync_overhead_bench.cpp -o sync_overhead_bench
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <functional>
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <climits>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "../common/barriers.h"
+
+using namespace std;
+
+// ============================================================================
+// CONFIGURATION
+// ============================================================================
+const int ROUNDS = 200;          // create/join and dispatch rounds per measurement
+const int PINGS = 20000;         // ping-pong round trips per measurement
+const int REPEATS = 3;           // best of
+
+int CORES = 1;
+
+static double now_ns() {
+    return chrono::duration<double, nano>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void pin_to(int cpu) {
+    if (cpu < 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % CORES, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static void unpin() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int c = 0; c < CORES; c++) CPU_SET(c, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// Best of REPEATS runs of f(), which returns nanoseconds per operation
+static double best_of(const function<double()>& f) {
+    double best = 1e30;
+    for (int r = 0; r < REPEATS; r++) best = min(best, f());
+    return best;
+}
+
+// ============================================================================
+// CREATE + JOIN
+// ============================================================================
+struct PinArg { int cpu; };
+
+static void* empty_pthread(void* v) {
+    pin_to(((PinArg*)v)->cpu);
+    return nullptr;
+}
+
+static double bench_pthread(int T, bool pinned) {
+    vector<pthread_t> ths(T);
+    vector<PinArg> args(T);
+    for (int t = 0; t < T; t++) args[t].cpu = pinned ? t : -1;
+    double t0 = now_ns();
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int t = 0; t < T; t++) pthread_create(&ths[t], nullptr, empty_pthread, &args[t]);
+        for (int t = 0; t < T; t++) pthread_join(ths[t], nullptr);
+    }
+    return (now_ns() - t0) / ROUNDS;
+}
+
+static double bench_std_thread(int T, bool pinned) {
+    double t0 = now_ns();
+    for (int r = 0; r < ROUNDS; r++) {
+        vector<thread> pool;
+        for (int t = 0; t < T; t++) pool.emplace_back([=]() { pin_to(pinned ? t : -1); });
+        for (auto& th : pool) th.join();
+    }
+    return (now_ns() - t0) / ROUNDS;
+}
+
+// ============================================================================
+// PERSISTENT POOL DISPATCH
+// ============================================================================
+// The caller acts as worker 0, like a real kernel launch would.
+class CvPool {
+public:
+    CvPool(int T, bool pinned) : T_(T) {
+        for (int t = 1; t < T; t++)
+            workers_.emplace_back([this, t, pinned]() {
+                pin_to(pinned ? t : -1);
+                long seen = 0;
+                for (;;) {
+                    unique_lock<mutex> lk(mu_);
+                    go_.wait(lk, [&]() { return gen_ != seen || stop_; });
+                    if (stop_) return;
+                    seen = gen_;
+                    lk.unlock();
+                    // empty task
+                    lk.lock();
+                    if (++done_ == T_ - 1) fin_.notify_one();
+                }
+            });
+    }
+    void dispatch() {
+        {
+            lock_guard<mutex> lk(mu_);
+            done_ = 0;
+            gen_++;
+        }
+        go_.notify_all();
+        unique_lock<mutex> lk(mu_);
+        fin_.wait(lk, [&]() { return done_ == T_ - 1; });
+    }
+    ~CvPool() {
+        {
+            lock_guard<mutex> lk(mu_);
+            stop_ = true;
+        }
+        go_.notify_all();
+        for (auto& w : workers_) w.join();
+    }
+private:
+    int T_;
+    mutex mu_;
+    condition_variable go_, fin_;
+    long gen_ = 0;
+    int done_ = 0;
+    bool stop_ = false;
+    vector<thread> workers_;
+};
+
+class SpinPool {
+public:
+    SpinPool(int T, bool pinned) : T_(T), spin_(hpc_barrier_spin(T)) {
+        for (int t = 1; t < T; t++)
+            workers_.emplace_back([this, t, pinned]() {
+                pin_to(pinned ? t : -1);
+                long seen = 0;
+                for (;;) {
+                    wait_until([&]() { return gen_.load(memory_order_acquire) != seen; });
+                    seen = gen_.load(memory_order_relaxed);
+                    if (stop_.load(memory_order_relaxed)) return;
+                    done_.fetch_add(1, memory_order_acq_rel);   // empty task
+                }
+            });
+    }
+    void dispatch() {
+        done_.store(0, memory_order_relaxed);
+        gen_.fetch_add(1, memory_order_release);
+        wait_until([&]() { return done_.load(memory_order_acquire) == T_ - 1; });
+    }
+    ~SpinPool() {
+        stop_.store(true, memory_order_relaxed);
+        gen_.fetch_add(1, memory_order_release);
+        for (auto& w : workers_) w.join();
+    }
+private:
+    template <class Pred>
+    void wait_until(Pred ready) {
+        for (int i = 0; !ready(); i++) {
+            if (i < spin_) hpc_cpu_relax();
+            else this_thread::yield();
+        }
+    }
+    int T_;
+    int spin_;
+    alignas(64) atomic<long> gen_{0};
+    alignas(64) atomic<int> done_{0};
+    atomic<bool> stop_{false};
+    vector<thread> workers_;
+};
+
+template <class Pool>
+static double bench_pool(int T, bool pinned) {
+    Pool pool(T, pinned);
+    pin_to(pinned ? 0 : -1);
+    for (int r = 0; r < 10; r++) pool.dispatch();   // warm-up
+    double t0 = now_ns();
+    for (int r = 0; r < ROUNDS * 10; r++) pool.dispatch();
+    double ns = (now_ns() - t0) / (ROUNDS * 10);
+    unpin();
+    return ns;
+}
+
+// ============================================================================
+// PING-PONG WAKEUP LATENCY
+// ============================================================================
+enum Placement { UNPINNED, SAME_CORE, CROSS_CORE };
+const char* PLACEMENT_NAMES[] = {"unpinned", "same-core", "cross-core"};
+
+static int cpu_for(Placement p, int side) {
+    if (p == UNPINNED) return -1;
+    if (p == SAME_CORE) return 0;
+    return side;   // 0 and 1
+}
+
+// Runs ping(i) on this thread and pong on a partner; returns one-way ns
+static double ping_pong(Placement p, const function<void()>& ping, const function<void()>& pong) {
+    thread partner([&]() {
+        pin_to(cpu_for(p, 1));
+        for (int i = 0; i < PINGS; i++) pong();
+    });
+    pin_to(cpu_for(p, 0));
+    double t0 = now_ns();
+    for (int i = 0; i < PINGS; i++) ping();
+    double ns = (now_ns() - t0) / PINGS / 2.0;
+    partner.join();
+    unpin();
+    return ns;
+}
+
+static double bench_cv(Placement p) {
+    mutex mu;
+    condition_variable cv;
+    int turn = 0;   // 0: partner's move, 1: main's move
+    return ping_pong(p,
+        [&]() {
+            unique_lock<mutex> lk(mu);
+            turn = 0;
+            cv.notify_all();
+            cv.wait(lk, [&]() { return turn == 1; });
+        },
+        [&]() {
+            unique_lock<mutex> lk(mu);
+            cv.wait(lk, [&]() { return turn == 0; });
+            turn = 1;
+            cv.notify_all();
+        });
+}
+
+static long futex_op(atomic<int>* w, int op, int val) {
+    return syscall(SYS_futex, reinterpret_cast<int*>(w), op, val, nullptr, nullptr, 0);
+}
+
+static double bench_futex(Placement p) {
+    alignas(64) atomic<int> word{1};   // 0: partner's move, 1: main's move
+    return ping_pong(p,
+        [&]() {
+            word.store(0, memory_order_release);
+            futex_op(&word, FUTEX_WAKE_PRIVATE, 1);
+            while (word.load(memory_order_acquire) != 1) futex_op(&word, FUTEX_WAIT_PRIVATE, 0);
+        },
+        [&]() {
+            while (word.load(memory_order_acquire) != 0) futex_op(&word, FUTEX_WAIT_PRIVATE, 1);
+            word.store(1, memory_order_release);
+            futex_op(&word, FUTEX_WAKE_PRIVATE, 1);
+        });
+}
+
+static double bench_spin(Placement p) {
+    alignas(64) atomic<int> word{1};
+    int spin = hpc_barrier_spin(p == SAME_CORE ? CORES + 1 : 2);
+    auto wait_for = [&](int v) {
+        for (int i = 0; word.load(memory_order_acquire) != v; i++) {
+            if (i < spin) hpc_cpu_relax();
+            else this_thread::yield();
+        }
+    };
+    return ping_pong(p,
+        [&]() { word.store(0, memory_order_release); wait_for(1); },
+        [&]() { wait_for(0); word.store(1, memory_order_release); });
+}
+
+// ============================================================================
+// SINGLE-THREAD ELEMENT COST (for the break-even table)
+// ============================================================================
+static double add_ns_per_element() {
+    const int N = 512;
+    vector<double> A((size_t)N * N, 1.0), B((size_t)N * N, 2.0), C((size_t)N * N, 0.0);
+    double best = 1e30;
+    for (int r = 0; r < 20; r++) {
+        double t0 = now_ns();
+        for (size_t k = 0; k < A.size(); k++) C[k] = A[k] + B[k];
+        best = min(best, (now_ns() - t0) / A.size());
+    }
+    if (C[7] != 3.0) cerr << "add check failed\n";
+    return best;
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+int main(int argc, char** argv) {
+    CORES = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int max_t = argc >= 2 ? atoi(argv[1]) : 16;
+    if (max_t < 2) max_t = 2;
+
+    vector<int> thread_counts;
+    for (int T = 1; T <= max_t; T *= 2) thread_counts.push_back(T);
+    if (thread_counts.back() != max_t) thread_counts.push_back(max_t);
+
+    ofstream csv("sync_overhead_results.csv");
+    csv << "test,threads,placement,ns\n";
+
+    cout << "================================================================\n";
+    cout << "  THREAD LAUNCH AND SYNCHRONIZATION OVERHEAD\n";
+    cout << "================================================================\n";
+    cout << "  cores: " << CORES << ", best of " << REPEATS << "\n\n";
+    cout << fixed << setprecision(0);
+
+    // ---- T-thread launch / dispatch costs ----
+    struct LaunchTest { string name; function<double(int, bool)> run; };
+    vector<LaunchTest> launch = {
+        {"pthread",    bench_pthread},
+        {"std_thread", bench_std_thread},
+        {"pool_cv",    bench_pool<CvPool>},
+        {"pool_spin",  bench_pool<SpinPool>},
+    };
+    // overhead[test][threads index], unpinned, for the break-even table
+    vector<vector<double>> overhead(launch.size(), vector<double>(thread_counts.size()));
+
+    cout << "Launch / dispatch cost per round (ns), unpinned | pinned\n";
+    cout << left << setw(9) << "threads";
+    for (auto& l : launch) cout << setw(22) << l.name;
+    cout << "\n" << string(9 + 22 * launch.size(), '-') << "\n";
+    for (size_t ti = 0; ti < thread_counts.size(); ti++) {
+        int T = thread_counts[ti];
+        cout << setw(9) << T;
+        for (size_t li = 0; li < launch.size(); li++) {
+            double u = best_of([&]() { return launch[li].run(T, false); });
+            double p = best_of([&]() { return launch[li].run(T, true); });
+            overhead[li][ti] = u;
+            csv << launch[li].name << "," << T << ",unpinned," << u << "\n";
+            csv << launch[li].name << "," << T << ",pinned," << p << "\n";
+            string cell = to_string((long)u) + " | " + to_string((long)p);
+            cout << setw(22) << cell << flush;
+        }
+        cout << "\n";
+    }
+
+    // ---- two-thread wakeup latency ----
+    cout << "\nOne-way wakeup latency (ns)\n";
+    cout << left << setw(12) << "placement" << setw(12) << "cv_wake" << setw(12) << "futex_wake"
+         << setw(12) << "spin" << "\n" << string(48, '-') << "\n";
+    for (int pi = UNPINNED; pi <= CROSS_CORE; pi++) {
+        Placement p = (Placement)pi;
+        if (p == CROSS_CORE && CORES < 2) {
+            cout << setw(12) << PLACEMENT_NAMES[p] << "(needs 2 cores)\n";
+            continue;
+        }
+        double cv = best_of([&]() { return bench_cv(p); });
+        double fx = best_of([&]() { return bench_futex(p); });
+        double sp = best_of([&]() { return bench_spin(p); });
+        cout << setw(12) << PLACEMENT_NAMES[p] << setw(12) << cv << setw(12) << fx << setw(12) << sp << "\n";
+        csv << "cv_wake,2," << PLACEMENT_NAMES[p] << "," << cv << "\n";
+        csv << "futex_wake,2," << PLACEMENT_NAMES[p] << "," << fx << "\n";
+        csv << "spin,2," << PLACEMENT_NAMES[p] << "," << sp << "\n";
+    }
+
+    // ---- break-even sizes ----
+    double t_elem = add_ns_per_element();
+    csv << "add_element,1,unpinned," << setprecision(3) << t_elem << "\n";
+    cout << setprecision(3) << "\nSingle-thread add: " << t_elem << " ns/element\n";
+    cout << "Smallest N for which an N x N add on T threads beats 1 thread:\n";
+    cout << left << setw(9) << "threads";
+    for (auto& l : launch) cout << setw(14) << l.name;
+    cout << "\n" << string(9 + 14 * launch.size(), '-') << "\n" << setprecision(0);
+    for (size_t ti = 0; ti < thread_counts.size(); ti++) {
+        int T = thread_counts[ti];
+        if (T == 1) continue;
+        cout << setw(9) << T;
+        for (size_t li = 0; li < launch.size(); li++) {
+            // parallel saves N^2 * t_elem * (1 - 1/T) but costs the dispatch;
+            // a core shared by k threads saves nothing beyond CORES
+            double eff = 1.0 - 1.0 / min(T, CORES);
+            if (eff <= 0.0) { cout << setw(14) << "never"; continue; }
+            double n = sqrt(overhead[li][ti] / (t_elem * eff));
+            cout << setw(14) << (long)ceil(n);
+            csv << "breakeven_N_" << launch[li].name << "," << T << ",unpinned," << ceil(n) << "\n";
+        }
+        cout << "\n";
+    }
+
+    cout << "\nResults written to sync_overhead_results.csv\n";
+    return 0;
+}
@@ -1,9 +1,15 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
+#include "../common/cache_probe.h"
+#include "../common/arena.h"
+#include "../common/memstats.h"
+#include "../common/perf_model.h"
+#include "../lib/hpcmat.h"
+
 #define RUNS 5     // number of repetitions per pattern
-#define BLOCK 64  // tile size
 
 // High-resolution timer
 double get_time() {
@@ -12,109 +18,86 @@ double get_time() {
     return ts.tv_sec + ts.tv_nsec * 1e-9;
 }
 
-// 0: Row-major (i, j)
-void pattern0(int N, double *A, double *x, double *y) {
-    for (int i = 0; i < N; i++) {
-        double sum = 0.0;
-        for (int j = 0; j < N; j++) {
-            sum += A[i * N + j] * x[j];
-        }
-        y[i] = sum;
-    }
-}
-
-// 1: Column-major (j, i)
-void pattern1(int N, double *A, double *x, double *y) {
-    for (int i = 0; i < N; i++) y[i] = 0.0;
-    for (int j = 0; j < N; j++) {
-        double xj = x[j];
-        for (int i = 0; i < N; i++) {
-            y[i] += A[i * N + j] * xj;
-        }
-    }
-}
-
-// 2: Row-major unrolled (4x)
-void pattern2(int N, double *A, double *x, double *y) {
-    for (int i = 0; i < N; i++) {
-        double sum = 0.0;
-        int j = 0;
-        for (; j <= N - 4; j += 4) {
-            sum += A[i * N + j]     * x[j];
-            sum += A[i * N + j + 1] * x[j + 1];
-            sum += A[i * N + j + 2] * x[j + 2];
-            sum += A[i * N + j + 3] * x[j + 3];
-        }
-        for (; j < N; j++) {
-            sum += A[i * N + j] * x[j];
-        }
-        y[i] = sum;
-    }
+// The eight patterns are lib/hpcmat.c's hpc_gemv patterns, in the same
+// order (HPC_GEMV_ROW .. HPC_GEMV_PANEL). Every one overwrites y: column-wise
+// ones store the j = 0 term first, so the harness never zeroes y between runs.
+// 0: row-major (i, j)               4: blocked row-major, x chunk in L1
+// 1: column-major (j, i)            5: pointer arithmetic row-major
+// 2: row-major unrolled (4x)        6: 8-row register-blocked, x in L1 chunks
+// 3: column-major unrolled (4x)     7: as 6 with L2-sized x panels, for wide A
+
+// Compulsory traffic of y = A x: A once, x once, y written plus write-allocate
+static double bytes_moved(int N) {
+    return sizeof(double) * ((double)N * N + 3.0 * N);
 }
 
-// 3: Column-major unrolled (4x)
-void pattern3(int N, double *A, double *x, double *y) {
-    for (int i = 0; i < N; i++) y[i] = 0.0;
-    for (int j = 0; j < N; j++) {
-        double xj = x[j];
-        int i = 0;
-        for (; i <= N - 4; i += 4) {
-            y[i]     += A[i * N + j]     * xj;
-            y[i + 1] += A[(i + 1) * N + j] * xj;
-            y[i + 2] += A[(i + 2) * N + j] * xj;
-            y[i + 3] += A[(i + 3) * N + j] * xj;
-        }
-        for (; i < N; i++) {
-            y[i] += A[i * N + j] * xj;
+// Wide shapes (few rows, x larger than L2): pattern0 against 6 and 7
+static void run_wide(hpc_ctx_t *ctx) {
+    int shapes[][2] = {{128, 1 << 17}, {16, 1 << 20}, {8, 1 << 22}};
+    int pats[] = {0, 6, 7};
+
+    printf("M,K,pattern,time_sec,checksum\n");
+    for (int s = 0; s < 3; s++) {
+        int M = shapes[s][0], K = shapes[s][1];
+        double *A = (double*)hpc_alloc((size_t)M * K * sizeof(double));
+        double *x = (double*)hpc_alloc((size_t)K * sizeof(double));
+        double *y = (double*)hpc_alloc((size_t)M * sizeof(double));
+        for (size_t i = 0; i < (size_t)M * K; i++) A[i] = 1.0;
+        for (int j = 0; j < K; j++) x[j] = 48.0 / K;
+
+        for (int q = 0; q < 3; q++) {
+            int p = pats[q];
+            double best_time = 1e9;
+            for (int r = 0; r <= RUNS; r++) {   // run 0 is warm-up
+                double start = get_time();
+                hpc_gemv(ctx, p, M, K, A, K, x, y);
+                double elapsed = get_time() - start;
+                if (r > 0 && elapsed < best_time) best_time = elapsed;
+            }
+            double checksum = 0.0;
+            for (int i = 0; i < M; i++) checksum += y[i];
+            printf("%d,%d,%d,%.9f,%.6f\n", M, K, p, best_time, checksum);
         }
+        hpc_free(A);
+        hpc_free(x);
+        hpc_free(y);
     }
 }
 
-// 4: Blocked row-major
-void pattern4(int N, double *A, double *x, double *y) {
-    for (int i = 0; i < N; i++) y[i] = 0.0;
-
-    for (int ii = 0; ii < N; ii += BLOCK) {
-        for (int jj = 0; jj < N; jj += BLOCK) {
-            int imax = (ii + BLOCK < N) ? ii + BLOCK : N;
-            int jmax = (jj + BLOCK < N) ? jj + BLOCK : N;
+int main(int argc, char **argv) {
+    int sizes[] = {256, 512, 1024, 2048};
+    int patterns = 8;
 
-            for (int i = ii; i < imax; i++) {
-                double sum = y[i];
-                for (int j = jj; j < jmax; j++) {
-                    sum += A[i * N + j] * x[j];
-                }
-                y[i] = sum;
-            }
-        }
+    // single-threaded, like the patterns always were
+    hpc_ctx_t *ctx = hpc_ctx_create(1, HPC_CTX_EXACT);
+    if (!ctx) {
+        fprintf(stderr, "hpc_ctx_create: %s\n", hpc_strerror(HPC_ENOMEM));
+        return 1;
     }
-}
-
-// 5: Pointer arithmetic row-major (FIXED)
-void pattern5(int N, double *A, double *x, double *y) {
-    for (int i = 0; i < N; i++) {
-        double *pA = A + i * N;   // reset pointer per row
-        double *px = x;
-        double sum = 0.0;
-        for (int j = 0; j < N; j++) {
-            sum += (*pA++) * (*px++);
-        }
-        y[i] = sum;
+#if defined(__AVX2__) && defined(__FMA__)
+    const char *simd = "avx2+fma";
+#else
+    const char *simd = "scalar";
+#endif
+    fprintf(stderr, "pattern4 block=%d pattern6 x-chunk=%d pattern7 x-panel=%d (%s)\n",
+            hpc_ctx_param(ctx, HPC_PARAM_GEMV_TILE), hpc_ctx_param(ctx, HPC_PARAM_GEMV_CHUNK),
+            hpc_ctx_param(ctx, HPC_PARAM_GEMV_PANEL), simd);
+
+    if (argc > 1 && strcmp(argv[1], "--wide") == 0) {
+        run_wide(ctx);
+        hpc_ctx_destroy(ctx);
+        return 0;
     }
-}
-
-int main() {
-    int sizes[] = {256, 512, 1024, 2048};
-    int patterns = 6;
 
-    printf("N,threads,pattern,time_sec,checksum\n");
+    printf("N,threads,pattern,time_sec,checksum,minflt,majflt,contaminated,"
+           "alloc_bytes,footprint_bytes,rss_peak_kb,bytes_moved,predicted_sec,model_ratio\n");
 
     for (int s = 0; s < 4; s++) {
         int N = sizes[s];
 
-        double *A = (double*)malloc(N * N * sizeof(double));
-        double *x = (double*)malloc(N * sizeof(double));
-        double *y = (double*)malloc(N * sizeof(double));
+        double *A = (double*)hpc_alloc(N * N * sizeof(double));
+        double *x = (double*)hpc_alloc(N * sizeof(double));
+        double *y = (double*)hpc_alloc(N * sizeof(double));
 
         for (int i = 0; i < N * N; i++) A[i] = 1.0 / N;
         for (int i = 0; i < N; i++) x[i] = 48.0 / N;
@@ -122,41 +105,60 @@ int main() {
         for (int p = 0; p < patterns; p++) {
 
             /* Warm-up */
-            pattern0(N, A, x, y);
+            hpc_gemv(ctx, HPC_GEMV_ROW, N, N, A, N, x, y);
 
             double best_time = 1e9;
+            hpc_faults_t best_faults = {0, 0};
+            int best_dirty = 1;
+            hpc_mem_t best_mem = {0, 0, 0, 0};
 
             for (int r = 0; r < RUNS; r++) {
-                for (int i = 0; i < N; i++) y[i] = 0.0;
-
+                hpc_mem_t mem;
+                hpc_mem_begin(&mem);
+                hpc_faults_t faults;
+                hpc_faults_begin(&faults);
                 double start = get_time();
 
-                switch (p) {
-                    case 0: pattern0(N, A, x, y); break;
-                    case 1: pattern1(N, A, x, y); break;
-                    case 2: pattern2(N, A, x, y); break;
-                    case 3: pattern3(N, A, x, y); break;
-                    case 4: pattern4(N, A, x, y); break;
-                    case 5: pattern5(N, A, x, y); break;
-                }
+                hpc_gemv(ctx, p, N, N, A, N, x, y);
 
                 double end = get_time();
+                hpc_faults_end(&faults);
+                hpc_mem_end(&mem);
                 double elapsed = end - start;
+                int dirty = hpc_faults_contaminated(&faults);
 
-                if (elapsed < best_time)
+                // a run that took page faults only counts if no clean one exists
+                if ((best_dirty && !dirty) || (dirty == best_dirty && elapsed < best_time)) {
                     best_time = elapsed;
+                    best_faults = faults;
+                    best_dirty = dirty;
+                    best_mem = mem;
+                }
             }
 
             double checksum = 0.0;
             for (int i = 0; i < N; i++) checksum += y[i];
 
-            printf("%d,1,%d,%.9f,%.6f\n", N, p, best_time, checksum);
+            // what the cache-traffic model expected; over 2x off is flagged
+            hpc_pm_shape_t shape = hpc_pm_shape_gemv(p);
+            double predicted = hpc_pm_predict_ns(&shape, N, 1, 0.0) / 1e9;
+            if (hpc_pm_deviates(best_time, predicted, 2.0))
+                fprintf(stderr, "model: N=%d pattern %d took %.2fx the predicted %.6fs\n",
+                        N, p, best_time / predicted, predicted);
+
+            printf("%d,1,%d,%.9f,%.6f,%ld,%ld,%d,%llu,%llu,%ld,%.0f,%.9f,%.3f\n", N, p, best_time, checksum,
+                   best_faults.minflt, best_faults.majflt, best_dirty,
+                   (unsigned long long)best_mem.alloc_bytes,
+                   (unsigned long long)best_mem.footprint_bytes, best_mem.rss_peak_kb,
+                   bytes_moved(N), predicted, best_time / predicted);
         }
 
-        free(A);
-        free(x);
-        free(y);
+        hpc_free(A);
+        hpc_free(x);
+        hpc_free(y);
     }
 
+    hpc_ctx_destroy(ctx);
+    hpc_arena_print_stats(stderr);
     return 0;
 }
@@ -1,7 +1,11 @@
 #!/bin/bash
 
 # Compile the program with optimization flags
-gcc -O2 c.c -o c
+CC=gcc
+CFLAGS="-O2 -march=native"   # -march=native enables the AVX2/FMA micro-kernel
+# the patterns are in the kernel library (lib/hpcmat.h), built with the same flags
+CC="$CC" CFLAGS="$CFLAGS" ../lib/build.sh
+$CC $CFLAGS c.c ../lib/libhpcmat.a -o c -lm -pthread
 
 # CSV file for results
 CSV_FILE="benchmark_results_full.csv"
@@ -9,6 +13,10 @@ CSV_FILE="benchmark_results_full.csv"
 # Clear and initialize CSV file
 echo "N,Pattern,PatternName,Time" > "$CSV_FILE"
 
+# CSV_FILE.meta.json: CPU, governor, compiler and flags of this run
+gcc -O2 ../common/fingerprint.c -o fingerprint
+./fingerprint "$CSV_FILE" "$CC" "$CFLAGS"
+
 # Matrix sizes to test
 SIZES=(256 512 1024 2048)
 
@@ -0,0 +1,62 @@
+#!/bin/bash
+
+# Strong and weak scaling of the distributed GEMV (gemv_dist.c).
+#   strong: N = BASE_N for every rank count, efficiency = t_1 / (P * t_P)
+#   weak:   N = BASE_N * sqrt(P), so every rank keeps BASE_N^2 elements
+#           of A (for GEMV, constant work and constant memory per rank are
+#           the same thing); efficiency = (N^2 / P / t_P) / (N_1^2 / t_1)
+# Ranks are forked processes of the local transport, or MPI processes with MPI=1.
+#
+# Usage: BASE_N=2048 RANKS="1 2 4 8" [MPI=1 MPIRUN_FLAGS=--oversubscribe] ./run_scaling.sh
+
+BASE_N=${BASE_N:-2048}
+RANKS=${RANKS:-"1 2 4 8 16"}
+CSV_FILE="scaling_gemv.csv"
+
+if [ "$MPI" == "1" ]; then
+    CC=mpicc
+    CFLAGS="-O2 -march=native -DHPC_USE_MPI"
+    $CC $CFLAGS gemv_dist.c -o gemv_dist_mpi -lm || exit 1
+else
+    CC=gcc
+    CFLAGS="-O2 -march=native -pthread"
+    $CC $CFLAGS gemv_dist.c -o gemv_dist -lm || exit 1
+fi
+
+run_gemv() {   # N P -> "N,P,dist,time,checksum"
+    if [ "$MPI" == "1" ]; then
+        mpirun $MPIRUN_FLAGS -np "$2" ./gemv_dist_mpi "$1" 0 | tail -n 1
+    else
+        ./gemv_dist "$1" "$2" | tail -n 1
+    fi
+}
+
+echo "mode,N,ranks,time_sec,checksum,efficiency" > "$CSV_FILE"
+gcc -O2 ../common/fingerprint.c -o fingerprint && ./fingerprint "$CSV_FILE" "$CC" "$CFLAGS"
+
+for mode in strong weak; do
+    echo "== $mode scaling, BASE_N=$BASE_N =="
+    rate1=""
+    for P in $RANKS; do
+        if [ "$mode" == "strong" ]; then
+            N=$BASE_N
+        else
+            N=$(awk -v b=$BASE_N -v p=$P 'BEGIN { n = int(b * sqrt(p) / 8 + 0.5) * 8; print (n < 8 ? 8 : n) }')
+        fi
+        line=$(run_gemv "$N" "$P")
+        time_value=$(echo "$line" | awk -F',' '{print $4}')
+        checksum=$(echo "$line" | awk -F',' '{print $5}')
+        if [ -z "$time_value" ]; then
+            echo "  P=$P N=$N: no result"
+            continue
+        fi
+        # per-rank element throughput; the first rank count is the reference
+        rate=$(awk -v n=$N -v p=$P -v t=$time_value 'BEGIN { printf "%.6e", n * n / p / t }')
+        [ -z "$rate1" ] && rate1=$rate
+        eff=$(awk -v r=$rate -v r1=$rate1 'BEGIN { printf "%.4f", r / r1 }')
+        echo "  P=$P N=$N time=$time_value efficiency=$eff"
+        echo "$mode,$N,$P,$time_value,$checksum,$eff" >> "$CSV_FILE"
+    done
+done
+
+echo "Results saved to $CSV_FILE"
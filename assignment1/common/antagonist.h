@@ -0,0 +1,220 @@
+/*
+ * antagonist.h - background noise threads for multi-tenant measurements
+ *
+ * Shared nodes run other jobs next to ours. An antagonist is a thread that
+ * keeps one kind of resource busy while a kernel is timed:
+ *
+ *   bw      bandwidth hog: read-modify-write streams over 4x the LLC
+ *   cache   cache thrasher: random line updates over one LLC's worth of
+ *           memory, evicting whatever the kernel keeps there
+ *   spin    compute spinner: independent multiply-add chains in registers,
+ *           takes issue slots (and the core, when it shares one)
+ *
+ * A spec lists antagonists as kind@cpus, comma separated: "bw@2",
+ * "cache@2-3,spin@4". Every cpu of a range gets its own thread, pinned
+ * there (modulo the online cores); a kind without @ runs unpinned.
+ * "none" or an empty spec starts nothing.
+ *
+ * hpc_antagonists_start returns once every thread has touched its buffer,
+ * so their page faults land before the caller's timed region; the threads
+ * then run until hpc_antagonists_stop, which reports the work each did.
+ *
+ * Header-only, usable from both C and C++ (C callers define _GNU_SOURCE
+ * for the affinity calls).
+ */
+#ifndef HPC_ANTAGONIST_H
+#define HPC_ANTAGONIST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "cache_probe.h"
+
+typedef enum { HPC_ANT_BW = 0, HPC_ANT_CACHE, HPC_ANT_SPIN, HPC_ANT_KINDS } hpc_ant_kind;
+
+static const char *const hpc_ant_names[HPC_ANT_KINDS] = {"bw", "cache", "spin"};
+
+#define HPC_ANT_MAX 64
+
+typedef struct {
+    hpc_ant_kind kind;
+    int cpu;                    /* -1 = unpinned */
+    size_t bytes;
+    double *buf;
+    volatile int *stop;
+    int *ready;
+    uint64_t ops;               /* lines (bw, cache) or multiply-adds / 8 (spin) */
+    pthread_t th;
+    char pad[64];
+} hpc_ant_thread;
+
+typedef struct {
+    int n;
+    volatile int stop;
+    int ready;
+    hpc_ant_thread t[HPC_ANT_MAX];
+} hpc_antagonists_t;
+
+static inline void *hpc_ant_main(void *v) {
+    hpc_ant_thread *a = (hpc_ant_thread *)v;
+    if (a->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(a->cpu % (int)sysconf(_SC_NPROCESSORS_ONLN), &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+    size_t n = a->bytes / sizeof(double);
+    if (a->buf)
+        for (size_t i = 0; i < n; i++) a->buf[i] = (double)(i & 7);
+    __atomic_fetch_add(a->ready, 1, __ATOMIC_RELEASE);
+
+    uint64_t ops = 0;
+    if (a->kind == HPC_ANT_BW) {
+        while (!*a->stop) {
+            for (size_t i = 0; i < n; i += 8) {
+                for (int u = 0; u < 8; u++) a->buf[i + u] += 1.0;
+                if ((i & 4095) == 0 && *a->stop) break;
+            }
+            ops += n / 8;
+        }
+    } else if (a->kind == HPC_ANT_CACHE) {
+        size_t lines = n / 8;
+        uint64_t s = 0x9e3779b97f4a7c15ULL + (uint64_t)a->cpu;
+        while (!*a->stop) {
+            for (int r = 0; r < 4096; r++) a->buf[(cp_rand(&s) % lines) * 8] += 1.0;
+            ops += 4096;
+        }
+    } else {
+        double x[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+        while (!*a->stop) {
+            for (int r = 0; r < 4096; r++)
+                for (int u = 0; u < 8; u++) x[u] = x[u] * 0.999999 + 1e-9;
+            ops += 4096;
+        }
+        volatile double sink = x[0] + x[7];
+        (void)sink;
+    }
+    a->ops = ops;
+    return NULL;
+}
+
+static inline hpc_ant_kind hpc_ant_parse_kind(const char *s, size_t len) {
+    for (int k = 0; k < HPC_ANT_KINDS; k++)
+        if (strlen(hpc_ant_names[k]) == len && strncmp(s, hpc_ant_names[k], len) == 0)
+            return (hpc_ant_kind)k;
+    return HPC_ANT_KINDS;
+}
+
+/* Parse spec into h (threads not started). Returns 0, or -1 on a bad spec. */
+static inline int hpc_antagonists_parse(hpc_antagonists_t *h, const char *spec) {
+    memset(h, 0, sizeof(*h));
+    if (!spec || !*spec || strcmp(spec, "none") == 0) return 0;
+    const char *p = spec;
+    while (*p) {
+        const char *end = strchr(p, ',');
+        if (!end) end = p + strlen(p);
+        const char *at = (const char *)memchr(p, '@', (size_t)(end - p));
+        hpc_ant_kind kind = hpc_ant_parse_kind(p, (size_t)((at ? at : end) - p));
+        if (kind == HPC_ANT_KINDS) return -1;
+        int lo = -1, hi = -1;
+        if (at) {
+            char *q;
+            lo = hi = (int)strtol(at + 1, &q, 10);
+            if (q == at + 1 || lo < 0) return -1;
+            if (*q == '-') {
+                hi = (int)strtol(q + 1, &q, 10);
+                if (hi < lo) return -1;
+            }
+            if (q != end) return -1;
+        }
+        for (int c = lo; c <= hi; c++) {
+            if (h->n == HPC_ANT_MAX) return -1;
+            h->t[h->n].kind = kind;
+            h->t[h->n].cpu = c;
+            h->n++;
+        }
+        p = *end ? end + 1 : end;
+    }
+    return 0;
+}
+
+static inline void hpc_antagonists_describe(const hpc_antagonists_t *h, char *out, size_t len) {
+    size_t used = 0;
+    out[0] = '\0';
+    if (h->n == 0) { snprintf(out, len, "none"); return; }
+    for (int i = 0; i < h->n && used < len; i++) {
+        const hpc_ant_thread *a = &h->t[i];
+        if (a->cpu >= 0)
+            used += snprintf(out + used, len - used, "%s%s@%d", i ? "+" : "", hpc_ant_names[a->kind], a->cpu);
+        else
+            used += snprintf(out + used, len - used, "%s%s", i ? "+" : "", hpc_ant_names[a->kind]);
+    }
+}
+
+/* Stop, join and unmap the first `started` antagonists (the one after them
+ * may hold a buffer but no thread) */
+static inline void hpc_ant_unwind(hpc_antagonists_t *h, int started) {
+    h->stop = 1;
+    for (int i = 0; i <= started && i < h->n; i++) {
+        hpc_ant_thread *a = &h->t[i];
+        if (i < started) pthread_join(a->th, NULL);
+        if (a->buf) munmap(a->buf, a->bytes);
+        a->buf = NULL;
+    }
+}
+
+/* Start the parsed antagonists; returns when all of them are running. On
+ * failure none is left running and -1 is returned. */
+static inline int hpc_antagonists_start(hpc_antagonists_t *h) {
+    if (h->n == 0) return 0;
+    cache_info_t ci;
+    cache_probe_host(&ci);
+    size_t llc = ci.l3_bytes ? ci.l3_bytes : ci.l2_bytes;
+    h->stop = 0;
+    h->ready = 0;
+    for (int i = 0; i < h->n; i++) {
+        hpc_ant_thread *a = &h->t[i];
+        a->stop = &h->stop;
+        a->ready = &h->ready;
+        a->ops = 0;
+        a->bytes = a->kind == HPC_ANT_BW ? 4 * llc : a->kind == HPC_ANT_CACHE ? llc : 0;
+        a->bytes = (a->bytes + 4095) & ~(size_t)4095;
+        a->buf = NULL;
+        if (a->bytes) {
+            void *m = mmap(NULL, a->bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (m == MAP_FAILED) {
+                hpc_ant_unwind(h, i);
+                return -1;
+            }
+            a->buf = (double *)m;
+        }
+        if (pthread_create(&a->th, NULL, hpc_ant_main, a) != 0) {
+            hpc_ant_unwind(h, i);
+            return -1;
+        }
+    }
+    while (__atomic_load_n(&h->ready, __ATOMIC_ACQUIRE) < h->n) sched_yield();
+    return 0;
+}
+
+/* Stop and join; returns the total ops done, per-thread counts stay in h->t */
+static inline uint64_t hpc_antagonists_stop(hpc_antagonists_t *h) {
+    uint64_t total = 0;
+    h->stop = 1;
+    for (int i = 0; i < h->n; i++) {
+        hpc_ant_thread *a = &h->t[i];
+        pthread_join(a->th, NULL);
+        total += a->ops;
+        if (a->buf) munmap(a->buf, a->bytes);
+        a->buf = NULL;
+    }
+    return total;
+}
+
+#endif
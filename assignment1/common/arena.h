@@ -0,0 +1,338 @@
+/*
+ * arena.h - thread-aware arena allocator for matrices and scratch buffers
+ *
+ * Each thread allocates from its own arena, so the fast path takes no lock:
+ *   - small blocks (<= 1 MB, header included) come in size classes of
+ *     64 B, 128 B, then four steps per octave from 256 B (so a row of
+ *     2^k doubles plus its header wastes at most 25%, not 100%), carved
+ *     from 2 MB slabs; freed blocks go back onto the
+ *     owner's per-class free list and are reused by the next request of
+ *     that class
+ *   - large blocks are whole 2 MB-aligned mappings, rounded up to 2 MB and
+ *     kept on a free list for reuse by a request of similar size
+ * Slabs and large mappings are advised MADV_HUGEPAGE, or mapped with
+ * MAP_HUGETLB when HPC_ARENA_HUGETLB=1. Every block is 64-byte aligned.
+ * Cached large mappings are capped at HPC_ARENA_CACHE_MB (default 512) per
+ * arena; beyond that the largest idle mapping is returned to the kernel.
+ *
+ * A block freed by a thread other than its owner is pushed onto the owner's
+ * lock-free remote-free stack and reclaimed on the owner's next allocation.
+ * Arenas of exited threads are adopted by the next new thread, so programs
+ * that spawn fresh threads per run keep recycling the same memory.
+ *
+ * HPC_ARENA=0 bypasses the arena (aligned_alloc/free) but keeps statistics,
+ * for A/B comparison against the system allocator.
+ *
+ * Header-only, usable from both C and C++; C++ also gets HpcArenaAllocator<T>
+ * for standard containers.
+ */
+#ifndef HPC_ARENA_H
+#define HPC_ARENA_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#define HPC_ARENA_SLAB      ((size_t)2 << 20)
+#define HPC_ARENA_CLASSES   51              /* 64 B .. 1 MB */
+#define HPC_ARENA_LARGE     0xFFFFu
+#define HPC_ARENA_PASSTHRU  0xFFFEu
+#define HPC_ARENA_MAGIC     0xA7E4A7E4u
+
+typedef struct hpc_arena hpc_arena;
+
+/* 64 bytes in front of every block; keeps the payload 64-byte aligned */
+typedef struct hpc_blockhdr {
+    uint32_t magic;
+    uint32_t cls;                   /* size class, or LARGE / PASSTHRU */
+    size_t size;                    /* block bytes including this header */
+    size_t requested;
+    hpc_arena *owner;
+    struct hpc_blockhdr *next;      /* free-list / remote-stack link */
+    char pad[24];
+} hpc_blockhdr;
+
+struct hpc_arena {
+    hpc_blockhdr *free_small[HPC_ARENA_CLASSES];
+    hpc_blockhdr *free_large;
+    size_t free_large_bytes;
+    hpc_blockhdr *remote;           /* blocks freed by other threads */
+    char *bump, *bump_end;          /* current slab */
+    hpc_arena *next_all;            /* registry of every arena */
+    hpc_arena *next_orphan;
+};
+
+typedef struct {
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t recycled;              /* allocations served from a free list */
+    uint64_t remote_frees;
+    uint64_t bytes_requested;       /* cumulative */
+    uint64_t bytes_in_use;
+    uint64_t peak_in_use;
+    uint64_t bytes_reserved;        /* live blocks incl. header and class rounding */
+    uint64_t mapped_bytes;          /* slabs + large mappings */
+    uint64_t hugetlb_bytes;         /* part of mapped_bytes backed by MAP_HUGETLB */
+    uint64_t arenas;
+} hpc_arena_stats_t;
+
+static hpc_arena_stats_t hpc_arena_g;
+static hpc_arena *hpc_arena_all;
+static hpc_arena *hpc_arena_orphans;
+static pthread_mutex_t hpc_arena_mu = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t hpc_arena_key;
+static pthread_once_t hpc_arena_once = PTHREAD_ONCE_INIT;
+static __thread hpc_arena *hpc_arena_tls;
+static int hpc_arena_mode = -1;     /* -1 unknown, 0 passthrough, 1 arena */
+
+#define HPC_STAT_ADD(f, v) __atomic_fetch_add(&hpc_arena_g.f, (v), __ATOMIC_RELAXED)
+
+/* 64, 128, 256, 320, 384, 448, 512, 640, ... 1 MB; all multiples of 64 */
+static inline size_t hpc_arena_class_size(unsigned cls) {
+    if (cls < 2) return (size_t)64 << cls;
+    cls -= 2;
+    return ((size_t)64 << (cls / 4)) * (4 + cls % 4);
+}
+
+static inline void hpc_arena_thread_exit(void *a) {
+    hpc_arena *arena = (hpc_arena *)a;
+    pthread_mutex_lock(&hpc_arena_mu);
+    arena->next_orphan = hpc_arena_orphans;
+    hpc_arena_orphans = arena;
+    pthread_mutex_unlock(&hpc_arena_mu);
+}
+
+static inline void hpc_arena_init_once(void) {
+    pthread_key_create(&hpc_arena_key, hpc_arena_thread_exit);
+    const char *env = getenv("HPC_ARENA");
+    hpc_arena_mode = (env && strcmp(env, "0") == 0) ? 0 : 1;
+}
+
+static inline hpc_arena *hpc_arena_self(void) {
+    if (hpc_arena_tls) return hpc_arena_tls;
+    pthread_once(&hpc_arena_once, hpc_arena_init_once);
+    pthread_mutex_lock(&hpc_arena_mu);
+    hpc_arena *a = hpc_arena_orphans;
+    if (a) {
+        hpc_arena_orphans = a->next_orphan;
+    } else {
+        a = (hpc_arena *)calloc(1, sizeof(hpc_arena));
+        if (!a) { pthread_mutex_unlock(&hpc_arena_mu); abort(); }
+        a->next_all = hpc_arena_all;
+        hpc_arena_all = a;
+        hpc_arena_g.arenas++;
+    }
+    pthread_mutex_unlock(&hpc_arena_mu);
+    pthread_setspecific(hpc_arena_key, a);
+    hpc_arena_tls = a;
+    return a;
+}
+
+/* 2 MB-aligned anonymous mapping of `bytes` (a multiple of 2 MB) */
+static inline void *hpc_arena_map(size_t bytes) {
+    const char *tlb = getenv("HPC_ARENA_HUGETLB");
+#ifdef MAP_HUGETLB
+    if (tlb && strcmp(tlb, "1") == 0) {
+        void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            HPC_STAT_ADD(mapped_bytes, bytes);
+            HPC_STAT_ADD(hugetlb_bytes, bytes);
+            return p;
+        }
+    }
+#else
+    (void)tlb;
+#endif
+    size_t span = bytes + HPC_ARENA_SLAB;
+    char *raw = (char *)mmap(NULL, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return NULL;
+    char *p = (char *)(((uintptr_t)raw + HPC_ARENA_SLAB - 1) & ~(uintptr_t)(HPC_ARENA_SLAB - 1));
+    if (p > raw) munmap(raw, p - raw);
+    if (raw + span > p + bytes) munmap(p + bytes, raw + span - (p + bytes));
+#ifdef MADV_HUGEPAGE
+    madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+    HPC_STAT_ADD(mapped_bytes, bytes);
+    return p;
+}
+
+static inline void hpc_arena_note_alloc(size_t requested, size_t reserved) {
+    HPC_STAT_ADD(allocs, 1);
+    HPC_STAT_ADD(bytes_reserved, reserved);
+    HPC_STAT_ADD(bytes_requested, requested);
+    uint64_t now = HPC_STAT_ADD(bytes_in_use, requested) + requested;
+    uint64_t peak = __atomic_load_n(&hpc_arena_g.peak_in_use, __ATOMIC_RELAXED);
+    while (now > peak &&
+           !__atomic_compare_exchange_n(&hpc_arena_g.peak_in_use, &peak, now, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+}
+
+static inline void hpc_arena_release(hpc_arena *a, hpc_blockhdr *h) {
+    if (h->cls == HPC_ARENA_LARGE) {
+        h->next = a->free_large;
+        a->free_large = h;
+        a->free_large_bytes += h->size;
+        const char *env = getenv("HPC_ARENA_CACHE_MB");
+        size_t cap = (size_t)(env ? atol(env) : 512) << 20;
+        while (a->free_large_bytes > cap) {
+            hpc_blockhdr **big = &a->free_large;
+            for (hpc_blockhdr **pp = &a->free_large; *pp; pp = &(*pp)->next)
+                if ((*pp)->size > (*big)->size) big = pp;
+            hpc_blockhdr *victim = *big;
+            *big = victim->next;
+            a->free_large_bytes -= victim->size;
+            __atomic_fetch_sub(&hpc_arena_g.mapped_bytes, victim->size, __ATOMIC_RELAXED);
+            munmap(victim, victim->size);
+        }
+    } else {
+        h->next = a->free_small[h->cls];
+        a->free_small[h->cls] = h;
+    }
+}
+
+static inline void hpc_arena_drain_remote(hpc_arena *a) {
+    if (!__atomic_load_n(&a->remote, __ATOMIC_RELAXED)) return;
+    hpc_blockhdr *h = __atomic_exchange_n(&a->remote, (hpc_blockhdr *)NULL, __ATOMIC_ACQUIRE);
+    while (h) {
+        hpc_blockhdr *next = h->next;
+        hpc_arena_release(a, h);
+        h = next;
+    }
+}
+
+/* 64-byte aligned block of at least `bytes`; NULL on failure */
+static inline void *hpc_alloc(size_t bytes) {
+    hpc_arena *a = hpc_arena_self();
+    size_t need = bytes + sizeof(hpc_blockhdr);
+    hpc_blockhdr *h = NULL;
+
+    if (hpc_arena_mode == 0) {
+        h = (hpc_blockhdr *)aligned_alloc(64, (need + 63) / 64 * 64);
+        if (!h) return NULL;
+        h->cls = HPC_ARENA_PASSTHRU;
+        h->size = need;
+    } else if (need <= hpc_arena_class_size(HPC_ARENA_CLASSES - 1)) {
+        unsigned cls = 0;
+        while (hpc_arena_class_size(cls) < need) cls++;
+        size_t sz = hpc_arena_class_size(cls);
+        hpc_arena_drain_remote(a);
+        if (a->free_small[cls]) {
+            h = a->free_small[cls];
+            a->free_small[cls] = h->next;
+            HPC_STAT_ADD(recycled, 1);
+        } else {
+            if (!a->bump || a->bump + sz > a->bump_end) {
+                /* the unused tail of the old slab is abandoned */
+                a->bump = (char *)hpc_arena_map(HPC_ARENA_SLAB);
+                if (!a->bump) return NULL;
+                a->bump_end = a->bump + HPC_ARENA_SLAB;
+            }
+            h = (hpc_blockhdr *)a->bump;
+            a->bump += sz;
+        }
+        h->cls = cls;
+        h->size = sz;
+    } else {
+        size_t sz = (need + HPC_ARENA_SLAB - 1) / HPC_ARENA_SLAB * HPC_ARENA_SLAB;
+        hpc_arena_drain_remote(a);
+        /* best fit among cached mappings, at most 25% larger than needed */
+        hpc_blockhdr **best = NULL;
+        for (hpc_blockhdr **pp = &a->free_large; *pp; pp = &(*pp)->next) {
+            if ((*pp)->size >= sz && (*pp)->size <= sz + sz / 4 &&
+                (!best || (*pp)->size < (*best)->size))
+                best = pp;
+        }
+        if (best) {
+            h = *best;
+            *best = h->next;
+            a->free_large_bytes -= h->size;
+            HPC_STAT_ADD(recycled, 1);
+        } else {
+            h = (hpc_blockhdr *)hpc_arena_map(sz);
+            if (!h) return NULL;
+            h->size = sz;
+        }
+        h->cls = HPC_ARENA_LARGE;
+    }
+    h->magic = HPC_ARENA_MAGIC;
+    h->owner = a;
+    h->requested = bytes;
+    hpc_arena_note_alloc(bytes, h->size);
+    return (char *)h + sizeof(hpc_blockhdr);
+}
+
+static inline void hpc_free(void *p) {
+    if (!p) return;
+    hpc_blockhdr *h = (hpc_blockhdr *)((char *)p - sizeof(hpc_blockhdr));
+    if (h->magic != HPC_ARENA_MAGIC) {
+        fprintf(stderr, "hpc_free: %p was not allocated by hpc_alloc\n", p);
+        abort();
+    }
+    HPC_STAT_ADD(frees, 1);
+    __atomic_fetch_sub(&hpc_arena_g.bytes_in_use, h->requested, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&hpc_arena_g.bytes_reserved, h->size, __ATOMIC_RELAXED);
+    if (h->cls == HPC_ARENA_PASSTHRU) {
+        h->magic = 0;
+        free(h);
+        return;
+    }
+    hpc_arena *self = hpc_arena_self();
+    if (h->owner == self) {
+        hpc_arena_release(self, h);
+        return;
+    }
+    HPC_STAT_ADD(remote_frees, 1);
+    hpc_arena *o = h->owner;
+    hpc_blockhdr *head = __atomic_load_n(&o->remote, __ATOMIC_RELAXED);
+    do {
+        h->next = head;
+    } while (!__atomic_compare_exchange_n(&o->remote, &head, h, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static inline void hpc_arena_stats(hpc_arena_stats_t *out) {
+    /* counters are updated with relaxed atomics; a snapshot is good enough */
+    *out = hpc_arena_g;
+}
+
+static inline void hpc_arena_print_stats(FILE *f) {
+    hpc_arena_stats_t s;
+    hpc_arena_stats(&s);
+    fprintf(f, "arena: %s allocs=%llu frees=%llu recycled=%llu remote_frees=%llu "
+               "requested=%.1fMB in_use=%.1fMB reserved=%.1fMB peak=%.1fMB mapped=%.1fMB hugetlb=%.1fMB arenas=%llu\n",
+            hpc_arena_mode == 0 ? "passthrough" : "on",
+            (unsigned long long)s.allocs, (unsigned long long)s.frees,
+            (unsigned long long)s.recycled, (unsigned long long)s.remote_frees,
+            s.bytes_requested / 1048576.0, s.bytes_in_use / 1048576.0, s.bytes_reserved / 1048576.0,
+            s.peak_in_use / 1048576.0, s.mapped_bytes / 1048576.0,
+            s.hugetlb_bytes / 1048576.0, (unsigned long long)s.arenas);
+}
+
+#ifdef __cplusplus
+#include <new>
+#include <cstddef>
+
+/* std::allocator replacement routing container storage through the arena */
+template <typename T>
+struct HpcArenaAllocator {
+    typedef T value_type;
+    HpcArenaAllocator() noexcept {}
+    template <typename U> HpcArenaAllocator(const HpcArenaAllocator<U>&) noexcept {}
+    T* allocate(std::size_t n) {
+        void* p = hpc_alloc(n * sizeof(T));
+        if (!p) throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+    void deallocate(T* p, std::size_t) noexcept { hpc_free(p); }
+};
+
+template <typename T, typename U>
+bool operator==(const HpcArenaAllocator<T>&, const HpcArenaAllocator<U>&) { return true; }
+template <typename T, typename U>
+bool operator!=(const HpcArenaAllocator<T>&, const HpcArenaAllocator<U>&) { return false; }
+#endif
+
+#endif
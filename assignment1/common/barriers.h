@@ -0,0 +1,259 @@
+/*
+ * barriers.h - user-space thread barriers for tight iterative kernels
+ *
+ * pthread_barrier_wait sleeps in the kernel on every episode, which costs
+ * microseconds - more than a whole 256x256 add. The barriers here keep the
+ * fast path in user space:
+ *
+ *   sense      centralized sense-reversing: one shared counter, waiters spin
+ *              on a shared sense flag flipped by the last arriver
+ *   tree       combining tree of fan-in 4: arrivals are counted on small
+ *              per-node counters, so no single line takes all n updates;
+ *              the thread completing the root flips the release flag
+ *   dissem     dissemination: ceil(log2 n) rounds, in round r thread t
+ *              signals thread t + 2^r and waits for t - 2^r; no counters,
+ *              every flag has one writer and one reader
+ *   hybrid     sense-reversing, but a waiter that spins past its budget
+ *              sleeps on the sense word as a futex
+ *   pthread    pthread_barrier_t, for comparison
+ *
+ * Spinning waiters call the pause instruction and fall back to sched_yield
+ * (hybrid: to the futex) after HPC_BARRIER_SPIN iterations (default 4000).
+ * When threads outnumber online cores the budget drops to 0 unless
+ * HPC_BARRIER_SPIN is set: a spinning waiter would only burn the time
+ * slice of the thread it waits for. Every shared word sits on its own
+ * 64-byte line.
+ *
+ * Threads pass their own id (0..n-1) to hpc_barrier_wait.
+ *
+ * Header-only, usable from both C and C++.
+ */
+#ifndef HPC_BARRIERS_H
+#define HPC_BARRIERS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+typedef enum {
+    HPC_BAR_PTHREAD = 0,
+    HPC_BAR_SENSE,
+    HPC_BAR_TREE,
+    HPC_BAR_DISSEM,
+    HPC_BAR_HYBRID,
+    HPC_BAR_KINDS
+} hpc_barrier_kind;
+
+static const char *const hpc_barrier_names[HPC_BAR_KINDS] = {
+    "pthread", "sense", "tree", "dissem", "hybrid"
+};
+
+#define HPC_BAR_FANIN 4
+
+typedef struct {
+    uint32_t v;
+    char pad[60];
+} hpc_bar_word;
+
+typedef struct {
+    uint32_t count;     /* arrivals still expected this episode */
+    uint32_t fanin;
+    int parent;         /* -1 at the root */
+    char pad[52];
+} hpc_bar_node;
+
+typedef struct {
+    uint32_t sense;     /* thread-local phase */
+    uint32_t parity;    /* dissemination flag set in use */
+    char pad[56];
+} hpc_bar_local;
+
+typedef struct {
+    hpc_barrier_kind kind;
+    int n;
+    int rounds;                 /* dissemination rounds */
+    int spin;                   /* spin budget before yield / futex */
+    pthread_barrier_t pb;
+    hpc_bar_word count;         /* centralized arrivals */
+    hpc_bar_word sense;         /* release flag / futex word */
+    hpc_bar_word sleepers;      /* hybrid: threads in futex wait */
+    hpc_bar_local *local;       /* [n] */
+    hpc_bar_node *nodes;        /* tree, leaves first */
+    hpc_bar_word *flags;        /* dissemination [n][2][rounds] */
+} hpc_barrier_t;
+
+static inline void hpc_cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/* Spin budget for a barrier of n threads */
+static inline int hpc_barrier_spin(int n) {
+    const char *env = getenv("HPC_BARRIER_SPIN");
+    if (env) return atoi(env) > 0 ? atoi(env) : 0;
+    return n > sysconf(_SC_NPROCESSORS_ONLN) ? 0 : 4000;
+}
+
+/* Spin (then yield) until *word == want */
+static inline void hpc_bar_spin_until(uint32_t *word, uint32_t want, int budget) {
+    for (int i = 0; __atomic_load_n(word, __ATOMIC_ACQUIRE) != want; i++) {
+        if (i < budget) hpc_cpu_relax();
+        else sched_yield();
+    }
+}
+
+static inline hpc_barrier_kind hpc_barrier_parse(const char *name) {
+    for (int k = 0; k < HPC_BAR_KINDS; k++)
+        if (name && strcmp(name, hpc_barrier_names[k]) == 0) return (hpc_barrier_kind)k;
+    return HPC_BAR_KINDS;
+}
+
+static inline int hpc_barrier_init(hpc_barrier_t *b, hpc_barrier_kind kind, int n) {
+    memset(b, 0, sizeof(*b));
+    if (n < 1 || kind >= HPC_BAR_KINDS) return -1;
+    b->kind = kind;
+    b->n = n;
+    b->count.v = n;
+    b->spin = hpc_barrier_spin(n);
+    b->local = (hpc_bar_local *)aligned_alloc(64, sizeof(hpc_bar_local) * n);
+    if (!b->local) return -1;
+    memset(b->local, 0, sizeof(hpc_bar_local) * n);
+
+    if (kind == HPC_BAR_PTHREAD) return pthread_barrier_init(&b->pb, NULL, n);
+
+    if (kind == HPC_BAR_TREE) {
+        /* level sizes: ceil(n/4), ceil(that/4), ... 1 */
+        int total = 0;
+        for (int w = n; ; w = (w + HPC_BAR_FANIN - 1) / HPC_BAR_FANIN) {
+            int nodes = (w + HPC_BAR_FANIN - 1) / HPC_BAR_FANIN;
+            total += nodes;
+            if (nodes == 1) break;
+        }
+        b->nodes = (hpc_bar_node *)aligned_alloc(64, sizeof(hpc_bar_node) * total);
+        if (!b->nodes) return -1;
+        int first = 0;
+        for (int w = n; ; ) {
+            int nodes = (w + HPC_BAR_FANIN - 1) / HPC_BAR_FANIN;
+            for (int i = 0; i < nodes; i++) {
+                hpc_bar_node *nd = &b->nodes[first + i];
+                int kids = w - i * HPC_BAR_FANIN;
+                nd->fanin = nd->count = kids < HPC_BAR_FANIN ? kids : HPC_BAR_FANIN;
+                nd->parent = nodes == 1 ? -1 : first + nodes + i / HPC_BAR_FANIN;
+            }
+            if (nodes == 1) break;
+            first += nodes;
+            w = nodes;
+        }
+    }
+
+    if (kind == HPC_BAR_DISSEM) {
+        while ((1 << b->rounds) < n) b->rounds++;
+        size_t cnt = (size_t)n * 2 * (b->rounds ? b->rounds : 1);
+        b->flags = (hpc_bar_word *)aligned_alloc(64, sizeof(hpc_bar_word) * cnt);
+        if (!b->flags) return -1;
+        memset(b->flags, 0, sizeof(hpc_bar_word) * cnt);
+    }
+    return 0;
+}
+
+static inline void hpc_barrier_destroy(hpc_barrier_t *b) {
+    if (b->kind == HPC_BAR_PTHREAD) pthread_barrier_destroy(&b->pb);
+    free(b->local);
+    free(b->nodes);
+    free(b->flags);
+    memset(b, 0, sizeof(*b));
+}
+
+/* Flip the release flag; hybrid also wakes threads that went to sleep.
+ * The flip and the sleeper check are seq_cst, pairing with the sleeper's
+ * increment and re-check, so a wake cannot be missed. */
+static inline void hpc_bar_release(hpc_barrier_t *b, uint32_t s) {
+    __atomic_store_n(&b->sense.v, s, __ATOMIC_SEQ_CST);
+    if (b->kind == HPC_BAR_HYBRID && __atomic_load_n(&b->sleepers.v, __ATOMIC_SEQ_CST))
+        syscall(SYS_futex, &b->sense.v, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+static inline void hpc_bar_hybrid_wait(hpc_barrier_t *b, uint32_t s) {
+    for (int i = 0; i < b->spin; i++) {
+        if (__atomic_load_n(&b->sense.v, __ATOMIC_ACQUIRE) == s) return;
+        hpc_cpu_relax();
+    }
+    __atomic_fetch_add(&b->sleepers.v, 1, __ATOMIC_SEQ_CST);
+    uint32_t v;
+    while ((v = __atomic_load_n(&b->sense.v, __ATOMIC_SEQ_CST)) != s)
+        syscall(SYS_futex, &b->sense.v, FUTEX_WAIT_PRIVATE, v, NULL, NULL, 0);
+    __atomic_fetch_sub(&b->sleepers.v, 1, __ATOMIC_RELAXED);
+}
+
+static inline void hpc_barrier_wait(hpc_barrier_t *b, int tid) {
+    hpc_bar_local *me = &b->local[tid];
+    if (b->n == 1) return;
+
+    switch (b->kind) {
+    case HPC_BAR_PTHREAD:
+        pthread_barrier_wait(&b->pb);
+        return;
+
+    case HPC_BAR_SENSE:
+    case HPC_BAR_HYBRID: {
+        uint32_t s = me->sense ^= 1;
+        if (__atomic_sub_fetch(&b->count.v, 1, __ATOMIC_ACQ_REL) == 0) {
+            /* nobody touches count again until the flip */
+            __atomic_store_n(&b->count.v, b->n, __ATOMIC_RELAXED);
+            hpc_bar_release(b, s);
+        } else if (b->kind == HPC_BAR_SENSE) {
+            hpc_bar_spin_until(&b->sense.v, s, b->spin);
+        } else {
+            hpc_bar_hybrid_wait(b, s);
+        }
+        return;
+    }
+
+    case HPC_BAR_TREE: {
+        uint32_t s = me->sense ^= 1;
+        int node = tid / HPC_BAR_FANIN;
+        for (;;) {
+            hpc_bar_node *nd = &b->nodes[node];
+            if (__atomic_sub_fetch(&nd->count, 1, __ATOMIC_ACQ_REL) != 0) {
+                hpc_bar_spin_until(&b->sense.v, s, b->spin);
+                return;
+            }
+            /* last arriver resets the node and climbs */
+            __atomic_store_n(&nd->count, nd->fanin, __ATOMIC_RELAXED);
+            if (nd->parent < 0) {
+                hpc_bar_release(b, s);
+                return;
+            }
+            node = nd->parent;
+        }
+    }
+
+    case HPC_BAR_DISSEM: {
+        uint32_t p = me->parity;
+        uint32_t s = me->sense ^ 1;   /* sense starts at 0: signal with 1 */
+        for (int r = 0; r < b->rounds; r++) {
+            int partner = (tid + (1 << r)) % b->n;
+            __atomic_store_n(&b->flags[((size_t)partner * 2 + p) * b->rounds + r].v, s, __ATOMIC_RELEASE);
+            hpc_bar_spin_until(&b->flags[((size_t)tid * 2 + p) * b->rounds + r].v, s, b->spin);
+        }
+        if (p == 1) me->sense ^= 1;
+        me->parity = p ^ 1;
+        return;
+    }
+
+    default:
+        return;
+    }
+}
+
+#endif
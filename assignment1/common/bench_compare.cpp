@@ -0,0 +1,327 @@
+/**
+ * bench_compare - gate kernel changes on measured performance
+ *
+ * Compares two benchmark result CSVs (results.csv, results_optimized.csv,
+ * matmul_results.csv, tile_queue_results.csv, ...). Rows are matched on
+ * their configuration columns; every row with the same configuration is
+ * one sample. Each side may list several files separated by commas, so
+ * repeated runs of a benchmark pool into larger samples.
+ *
+ * Per configuration:
+ *   - both sides have >= 2 samples: Welch's t-test on the means; a change
+ *     counts only if p < alpha AND it exceeds the threshold
+ *   - otherwise: threshold on the single (or best) values
+ * Rows flagged contaminated (page faults in the timed region) are skipped.
+ * A row whose field count differs from the header is an input error.
+ *
+ * Exit status: 0 no regression, 1 regression beyond threshold, 2 usage or
+ * input error.
+ *
+ * USAGE: ./bench_compare BASE.csv[,BASE2.csv...] NEW.csv[,NEW2.csv...]
+ *            [--key col,col] [--metric col] [--higher-better]
+ *            [--threshold 0.05] [--alpha 0.05] [--quiet]
+ * Build: g++ -O2 bench_compare.cpp -o bench_compare
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+using namespace std;
+
+// Columns that identify a configuration, in the spelling used across the repo
+const set<string> KEY_NAMES = {
+    "N", "M", "K", "threads", "Threads", "pattern", "pattern_name", "Pattern", "PatternName",
+    "MatrixSize", "Method", "Op", "Strategy", "Grain", "procs", "ranks", "P", "version",
+    "barrier", "antagonists", "Mode", "mode", "BaseSize", "base_N"
+};
+// Candidate metric columns, in order of preference
+const vector<string> METRIC_NAMES = {
+    "sec", "time_sec", "TimeSeconds", "Time", "best_time_sec", "seconds"
+};
+
+struct Table {
+    vector<string> header;
+    vector<vector<string>> rows;
+};
+
+static vector<string> split(const string& s, char sep) {
+    vector<string> out;
+    string cur;
+    stringstream ss(s);
+    while (getline(ss, cur, sep)) {
+        while (!cur.empty() && (cur.back() == '\r' || cur.back() == ' ')) cur.pop_back();
+        size_t b = cur.find_first_not_of(' ');
+        out.push_back(b == string::npos ? "" : cur.substr(b));
+    }
+    if (!s.empty() && s.back() == sep) out.push_back("");
+    return out;
+}
+
+static bool load(const string& path, Table& t) {
+    ifstream in(path);
+    if (!in) {
+        cerr << "bench_compare: cannot open " << path << "\n";
+        return false;
+    }
+    string line;
+    vector<string> header;
+    int malformed = 0, first_bad = 0, lineno = 0;
+    while (getline(in, line)) {
+        lineno++;
+        if (line.empty() || line[0] == '#') continue;
+        vector<string> f = split(line, ',');
+        if (header.empty()) {
+            header = f;
+            continue;
+        }
+        if (f == header) continue;           // header repeated by appending scripts
+        if (f.size() != header.size()) {
+            if (!malformed++) first_bad = lineno;
+            continue;
+        }
+        t.rows.push_back(f);
+    }
+    if (header.empty()) {
+        cerr << "bench_compare: " << path << " is empty\n";
+        return false;
+    }
+    // a row that does not match the header means writer and header disagree;
+    // comparing what is left would hide it
+    if (malformed) {
+        cerr << "bench_compare: " << path << ": " << malformed << " row(s) with a field count other than the header's "
+             << header.size() << " (first at line " << first_bad << ")\n";
+        return false;
+    }
+    if (!t.header.empty() && t.header != header) {
+        cerr << "bench_compare: " << path << " has a different header\n";
+        return false;
+    }
+    t.header = header;
+    return true;
+}
+
+static int column(const vector<string>& header, const string& name) {
+    for (size_t i = 0; i < header.size(); i++)
+        if (header[i] == name) return (int)i;
+    return -1;
+}
+
+// ============================================================================
+// STATISTICS
+// ============================================================================
+struct Sample {
+    vector<double> v;
+    double mean() const {
+        double s = 0.0;
+        for (double x : v) s += x;
+        return s / v.size();
+    }
+    double var() const {
+        if (v.size() < 2) return 0.0;
+        double m = mean(), s = 0.0;
+        for (double x : v) s += (x - m) * (x - m);
+        return s / (v.size() - 1);
+    }
+    double best(bool higher) const {
+        return higher ? *max_element(v.begin(), v.end()) : *min_element(v.begin(), v.end());
+    }
+};
+
+// Continued fraction for the regularized incomplete beta function
+static double beta_cf(double a, double b, double x) {
+    const double tiny = 1e-300;
+    double c = 1.0, d = 1.0 - (a + b) * x / (a + 1.0);
+    if (fabs(d) < tiny) d = tiny;
+    d = 1.0 / d;
+    double h = d;
+    for (int m = 1; m <= 300; m++) {
+        double m2 = 2.0 * m;
+        double aa = m * (b - m) * x / ((a + m2 - 1.0) * (a + m2));
+        d = 1.0 + aa * d; if (fabs(d) < tiny) d = tiny;
+        c = 1.0 + aa / c; if (fabs(c) < tiny) c = tiny;
+        d = 1.0 / d;
+        h *= d * c;
+        aa = -(a + m) * (a + b + m) * x / ((a + m2) * (a + m2 + 1.0));
+        d = 1.0 + aa * d; if (fabs(d) < tiny) d = tiny;
+        c = 1.0 + aa / c; if (fabs(c) < tiny) c = tiny;
+        d = 1.0 / d;
+        double del = d * c;
+        h *= del;
+        if (fabs(del - 1.0) < 1e-12) break;
+    }
+    return h;
+}
+
+static double incomplete_beta(double a, double b, double x) {
+    if (x <= 0.0) return 0.0;
+    if (x >= 1.0) return 1.0;
+    double front = exp(lgamma(a + b) - lgamma(a) - lgamma(b) + a * log(x) + b * log(1.0 - x));
+    if (x < (a + 1.0) / (a + b + 2.0)) return front * beta_cf(a, b, x) / a;
+    return 1.0 - front * beta_cf(b, a, 1.0 - x) / b;
+}
+
+// Two-sided p-value of Welch's t-test
+static double welch_p(const Sample& a, const Sample& b) {
+    double va = a.var() / a.v.size(), vb = b.var() / b.v.size();
+    if (va + vb == 0.0) return a.mean() == b.mean() ? 1.0 : 0.0;
+    double t = (a.mean() - b.mean()) / sqrt(va + vb);
+    double df = (va + vb) * (va + vb) /
+                (va * va / (a.v.size() - 1) + vb * vb / (b.v.size() - 1));
+    return incomplete_beta(df / 2.0, 0.5, df / (df + t * t));
+}
+
+// ============================================================================
+// MAIN
+// ============================================================================
+static void usage() {
+    cerr << "usage: bench_compare BASE.csv[,BASE2.csv...] NEW.csv[,NEW2.csv...]\n"
+         << "         [--key col,col] [--metric col] [--higher-better]\n"
+         << "         [--threshold 0.05] [--alpha 0.05] [--quiet]\n";
+}
+
+int main(int argc, char** argv) {
+    vector<string> paths;
+    string key_arg, metric;
+    bool higher = false, quiet = false;
+    double threshold = 0.05, alpha = 0.05;
+
+    for (int a = 1; a < argc; a++) {
+        string s = argv[a];
+        bool has_val = a + 1 < argc;
+        if (s == "--key" && has_val) key_arg = argv[++a];
+        else if (s == "--metric" && has_val) metric = argv[++a];
+        else if (s == "--threshold" && has_val) threshold = atof(argv[++a]);
+        else if (s == "--alpha" && has_val) alpha = atof(argv[++a]);
+        else if (s == "--higher-better") higher = true;
+        else if (s == "--quiet") quiet = true;
+        else if (!s.empty() && s[0] == '-') { usage(); return 2; }
+        else paths.push_back(s);
+    }
+    if (paths.size() != 2) { usage(); return 2; }
+
+    Table side[2];
+    for (int i = 0; i < 2; i++)
+        for (auto& p : split(paths[i], ','))
+            if (!p.empty() && !load(p, side[i])) return 2;
+    if (side[0].header != side[1].header) {
+        cerr << "bench_compare: BASE and NEW have different columns\n";
+        return 2;
+    }
+    const vector<string>& header = side[0].header;
+
+    // Metric column: explicit, else the first known time column
+    if (metric.empty())
+        for (auto& m : METRIC_NAMES)
+            if (column(header, m) >= 0) { metric = m; break; }
+    int mcol = column(header, metric);
+    if (mcol < 0) {
+        cerr << "bench_compare: no metric column (use --metric)\n";
+        return 2;
+    }
+
+    // Key columns: explicit, else every known configuration column
+    vector<int> kcols;
+    if (!key_arg.empty()) {
+        for (auto& k : split(key_arg, ',')) {
+            int c = column(header, k);
+            if (c < 0) { cerr << "bench_compare: no column " << k << "\n"; return 2; }
+            kcols.push_back(c);
+        }
+    } else {
+        for (size_t i = 0; i < header.size(); i++)
+            if (KEY_NAMES.count(header[i]) && (int)i != mcol) kcols.push_back((int)i);
+    }
+    // a/b/c/d results say "version" only in summaries; comparing across
+    // versions is the point, so never key on it implicitly
+    if (key_arg.empty()) {
+        int vcol = column(header, "version");
+        kcols.erase(remove(kcols.begin(), kcols.end(), vcol), kcols.end());
+    }
+    int dirty_col = column(header, "contaminated");
+    if (dirty_col < 0) dirty_col = column(header, "Contaminated");
+
+    map<string, Sample> samples[2];
+    vector<string> order;
+    int skipped = 0;
+    for (int i = 0; i < 2; i++) {
+        for (auto& r : side[i].rows) {
+            if (dirty_col >= 0 && r[dirty_col] == "1") { skipped++; continue; }
+            string k;
+            for (int c : kcols) k += (k.empty() ? "" : ",") + header[c] + "=" + r[c];
+            char* end = nullptr;
+            double v = strtod(r[mcol].c_str(), &end);
+            if (end == r[mcol].c_str() || !isfinite(v)) continue;
+            if (i == 0 && !samples[0].count(k)) order.push_back(k);
+            samples[i][k].v.push_back(v);
+        }
+    }
+
+    int faster = 0, slower = 0, same = 0, unmatched = 0, regressions = 0;
+    double log_ratio_sum = 0.0;
+    int matched = 0;
+
+    // Configuration column: wide enough that no two keys print alike
+    size_t kw = 44;
+    for (auto& k : order) kw = max(kw, k.size() + 1);
+
+    if (!quiet) {
+        cout << "metric: " << metric << (higher ? " (higher is better)" : " (lower is better)")
+             << "  threshold: " << threshold * 100 << "%  alpha: " << alpha << "\n";
+        cout << left << setw(kw) << "configuration" << right << setw(13) << "base"
+             << setw(13) << "new" << setw(9) << "change" << setw(9) << "p" << "  verdict\n";
+        cout << string(kw + 56, '-') << "\n";
+    }
+    for (auto& k : order) {
+        if (!samples[1].count(k)) { unmatched++; continue; }
+        const Sample& b = samples[0][k];
+        const Sample& n = samples[1][k];
+        bool tested = b.v.size() >= 2 && n.v.size() >= 2;
+        double bv = tested ? b.mean() : b.best(higher);
+        double nv = tested ? n.mean() : n.best(higher);
+        if (bv <= 0.0 || nv <= 0.0) continue;
+        double p = tested ? welch_p(b, n) : -1.0;
+
+        // change > 0 means NEW is better
+        double change = higher ? nv / bv - 1.0 : bv / nv - 1.0;
+        bool significant = !tested || p < alpha;
+        string verdict = "same";
+        if (significant && change > threshold) { verdict = "FASTER"; faster++; }
+        else if (significant && change < -threshold) { verdict = "REGRESSION"; slower++; regressions++; }
+        else same++;
+        log_ratio_sum += log(1.0 + change);
+        matched++;
+
+        if (!quiet || verdict == "REGRESSION") {
+            cout << left << setw(kw) << k << right << scientific << setprecision(4)
+                 << setw(13) << bv << setw(13) << nv << fixed << setprecision(1)
+                 << setw(8) << change * 100 << "%";
+            if (tested) cout << setw(9) << setprecision(4) << p;
+            else cout << setw(9) << "-";
+            cout << "  " << verdict << "\n";
+        }
+    }
+    for (auto& kv : samples[1])
+        if (!samples[0].count(kv.first)) unmatched++;
+
+    cout << "\nmatched " << matched << " configurations: " << faster << " faster, "
+         << slower << " slower, " << same << " unchanged";
+    if (matched) cout << "; geometric-mean change " << fixed << setprecision(1)
+                      << (exp(log_ratio_sum / matched) - 1.0) * 100 << "%";
+    cout << "\n";
+    if (unmatched) cout << unmatched << " configuration(s) present on one side only\n";
+    if (skipped) cout << skipped << " contaminated row(s) skipped\n";
+    if (!matched) {
+        cerr << "bench_compare: no configurations in common\n";
+        return 2;
+    }
+    return regressions ? 1 : 0;
+}
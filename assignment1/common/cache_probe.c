@@ -0,0 +1,18 @@
+// Standalone host cache probe: prints measured parameters and the tile
+// sizes the blocked kernels will pick up, and refreshes the per-host cache.
+// Build: gcc -O2 cache_probe.c -o cache_probe -lm
+#include "cache_probe.h"
+
+int main(void) {
+    cache_info_t ci;
+    char path[256];
+
+    cache_probe_measure(&ci);
+    cp_cache_path(path, sizeof(path));
+    cp_save(&ci, path);
+
+    cache_probe_print(stdout, &ci);
+    printf("tiles: add_blocked_32/worker_blocked=%d pattern4=%d (saved to %s)\n",
+           cache_tile_square(&ci, 3), cache_tile_gemv(&ci), path);
+    return 0;
+}
@@ -0,0 +1,392 @@
+/*
+ * cache_probe.h - measured cache hierarchy parameters for tile-size defaults
+ *
+ * Pointer-chasing latency probe (random cyclic permutation, one node per
+ * cache line) over growing working sets. Latency knees give the effective
+ * L1/L2/L3 capacities; a one-node-per-page chase gives TLB reach; a strided
+ * forward chase gives the line size; a streaming read per level gives
+ * bandwidth. Anything the probe cannot resolve falls back to sysfs.
+ *
+ * Results are cached per host in /tmp/hpc_cache_probe.<hostname> (override
+ * with HPC_CACHE_PROBE_FILE) so programs only pay the ~1s probe once.
+ *   HPC_REPROBE=1     ignore the cached file and probe again
+ *   HPC_CACHE_PROBE=0 skip measuring, use sysfs values only
+ *   HPC_TILE=n        force every derived tile size to n
+ *
+ * Header-only, usable from both the C and the C++ programs.
+ */
+#ifndef HPC_CACHE_PROBE_H
+#define HPC_CACHE_PROBE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define CACHE_PROBE_MAX_POINTS 48
+
+typedef struct {
+    size_t line_size;
+    size_t l1_bytes;
+    size_t l2_bytes;
+    size_t l3_bytes;
+    size_t dtlb_reach;      /* first-level data TLB reach (4K pages) */
+    size_t stlb_reach;      /* second-level TLB reach, 0 if not resolved */
+    double lat_ns[4];       /* load-to-use latency: L1, L2, L3, DRAM */
+    double bw_gbs[4];       /* single-thread read bandwidth: L1, L2, L3, DRAM */
+    int measured;           /* 1 = probe results, 0 = sysfs/defaults only */
+} cache_info_t;
+
+static inline double cp_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static inline uint64_t cp_rand(uint64_t *s) {
+    uint64_t x = *s;
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    return *s = x;
+}
+
+static inline void *cp_map(size_t bytes, int huge) {
+    void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return NULL;
+#ifdef MADV_HUGEPAGE
+    madvise(p, bytes, huge ? MADV_HUGEPAGE : MADV_NOHUGEPAGE);
+#else
+    (void)huge;
+#endif
+    return p;
+}
+
+/* sysfs value for cache index i, e.g. "48K" -> 49152; 0 if absent */
+static inline size_t cp_sysfs_size(int level) {
+    char path[128], buf[64];
+    for (int i = 0; i < 8; i++) {
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/level", i);
+        FILE *f = fopen(path, "r");
+        if (!f) break;
+        int lv = 0;
+        if (fscanf(f, "%d", &lv) != 1) lv = 0;
+        fclose(f);
+        if (lv != level) continue;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/type", i);
+        f = fopen(path, "r");
+        if (!f) continue;
+        if (!fgets(buf, sizeof(buf), f)) buf[0] = 0;
+        fclose(f);
+        if (strncmp(buf, "Instruction", 11) == 0) continue;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", i);
+        f = fopen(path, "r");
+        if (!f) continue;
+        size_t v = 0; char unit = 0;
+        if (fscanf(f, "%zu%c", &v, &unit) < 1) v = 0;
+        fclose(f);
+        if (unit == 'K') v <<= 10; else if (unit == 'M') v <<= 20;
+        return v;
+    }
+    return 0;
+}
+
+static inline size_t cp_sysfs_line(void) {
+    long v = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+    return v > 0 ? (size_t)v : 64;
+}
+
+/* Build a random cyclic chain through `count` nodes spaced `stride` bytes
+ * apart (Sattolo shuffle) and return ns per dependent load. */
+static inline double cp_chase(char *buf, size_t count, size_t stride, size_t offset_step, long loads) {
+    size_t *order = (size_t *)malloc(count * sizeof(size_t));
+    if (!order) return 0.0;
+    uint64_t seed = 0x9E3779B97F4A7C15ULL ^ count;
+    for (size_t i = 0; i < count; i++) order[i] = i;
+    for (size_t i = count - 1; i > 0; i--) {
+        size_t j = (size_t)(cp_rand(&seed) % i);
+        size_t t = order[i]; order[i] = order[j]; order[j] = t;
+    }
+    /* node k sits at the start of slot k, shifted by a line-aligned
+     * offset so page-strided chains do not all map to one cache set */
+#define CP_NODE(k) (buf + order[k] * stride + (order[k] * offset_step % stride) / 64 * 64)
+    for (size_t i = 0; i < count; i++)
+        *(void **)CP_NODE(i) = (void *)CP_NODE((i + 1) % count);
+    void *p = (void *)CP_NODE(0);
+#undef CP_NODE
+    free(order);
+
+    for (long i = 0; i < (long)count; i++) p = *(void **)p;   /* warm */
+    double t0 = cp_now_ns();
+    for (long i = 0; i < loads; i += 8) {
+        p = *(void **)p; p = *(void **)p; p = *(void **)p; p = *(void **)p;
+        p = *(void **)p; p = *(void **)p; p = *(void **)p; p = *(void **)p;
+    }
+    double t1 = cp_now_ns();
+    *(void *volatile *)&buf[0] = p;   /* keep the chain live */
+    return (t1 - t0) / (double)loads;
+}
+
+/* Working-set sizes whose latency jumps: returns number of knees found.
+ * A knee is recorded at the last size before latency exceeds the current
+ * plateau by `ratio`; the next plateau starts once the climb flattens. */
+static inline int cp_knees(const size_t *sizes, const double *lat, int n, double ratio,
+                           size_t *knees, double *plateaus, int max_knees) {
+    int found = 0;
+    double base = lat[0];
+    if (plateaus) plateaus[0] = base;
+    for (int i = 1; i < n && found < max_knees; i++) {
+        if (lat[i] > base * ratio) {
+            knees[found++] = sizes[i - 1];
+            while (i + 1 < n && lat[i + 1] > lat[i] * 1.15) i++;
+            base = lat[i];
+            if (plateaus) plateaus[found] = base;
+        } else if (lat[i] < base) {
+            base = lat[i];
+        }
+    }
+    return found;
+}
+
+/* Streaming read bandwidth (GB/s) over a buffer of `bytes`. */
+static inline double cp_read_bw(size_t bytes) {
+    size_t n = bytes / sizeof(double);
+    if (n < 64) n = 64;
+    double *a = (double *)cp_map(n * sizeof(double), 1);
+    if (!a) return 0.0;
+    for (size_t i = 0; i < n; i++) a[i] = (double)(i & 7);
+    size_t target = (size_t)256 << 20;   /* ~256 MB streamed per point */
+    long reps = (long)(target / (n * sizeof(double)));
+    if (reps < 2) reps = 2;
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    double best = 1e30;
+    for (int trial = 0; trial < 3; trial++) {
+        double t0 = cp_now_ns();
+        for (long r = 0; r < reps; r++) {
+            for (size_t i = 0; i + 3 < n; i += 4) {
+                s0 += a[i]; s1 += a[i + 1]; s2 += a[i + 2]; s3 += a[i + 3];
+            }
+        }
+        double dt = cp_now_ns() - t0;
+        if (dt < best) best = dt;
+    }
+    *(volatile double *)&a[0] = s0 + s1 + s2 + s3;
+    munmap(a, n * sizeof(double));
+    return (double)reps * n * sizeof(double) / best;   /* bytes per ns = GB/s */
+}
+
+/* Measured capacity more than a factor of 2 away from a known sysfs one */
+static inline int cp_off_sysfs(size_t measured, size_t sys) {
+    return sys && (measured > sys * 2 || measured < sys / 2);
+}
+
+static inline void cp_fill_sysfs(cache_info_t *ci) {
+    memset(ci, 0, sizeof(*ci));
+    ci->line_size = cp_sysfs_line();
+    ci->l1_bytes = cp_sysfs_size(1);
+    ci->l2_bytes = cp_sysfs_size(2);
+    ci->l3_bytes = cp_sysfs_size(3);
+    if (!ci->l1_bytes) ci->l1_bytes = 32 << 10;
+    if (!ci->l2_bytes) ci->l2_bytes = 256 << 10;
+    ci->dtlb_reach = 64 * 4096;
+}
+
+/* Run the full probe. Takes roughly a second on a typical host. */
+static inline void cache_probe_measure(cache_info_t *ci) {
+    cache_info_t sys;
+    cp_fill_sysfs(&sys);
+    *ci = sys;
+
+    /* Latency vs working set: 4 KB .. 64 MB (or 2x LLC if smaller), x1.5 steps */
+    size_t max_ws = (size_t)64 << 20;
+    if (sys.l3_bytes && sys.l3_bytes * 2 < max_ws) max_ws = sys.l3_bytes * 2;
+    size_t sizes[CACHE_PROBE_MAX_POINTS];
+    double lat[CACHE_PROBE_MAX_POINTS] = {0};
+    int n = 0;
+    char *buf = (char *)cp_map(max_ws, 1);
+    if (!buf) return;
+    for (size_t ws = 4096; ws <= max_ws && n < CACHE_PROBE_MAX_POINTS; ) {
+        sizes[n] = ws;
+        lat[n] = cp_chase(buf, ws / 64, 64, 0, ws > (8u << 20) ? 1L << 20 : 1L << 21);
+        n++;
+        ws = (n & 1) ? ws + ws / 2 : ws / 3 * 4;   /* 4K, 6K, 8K, 12K, 16K ... */
+    }
+    munmap(buf, max_ws);
+
+    size_t knees[3] = {0, 0, 0};
+    double plateaus[4] = {lat[0], 0, 0, 0};
+    int k = cp_knees(sizes, lat, n, 1.5, knees, plateaus, 3);
+    if (k >= 1) ci->l1_bytes = knees[0];
+    if (k >= 2) ci->l2_bytes = knees[1];
+    if (k >= 3) ci->l3_bytes = knees[2];
+    for (int i = 0; i < 4; i++) ci->lat_ns[i] = i <= k ? plateaus[i] : 0.0;
+    /* a capacity sitting far from the sysfs value is a mis-detected knee
+     * (e.g. an L2 adjacent-line prefetch bump); prefer sysfs then */
+    if (cp_off_sysfs(ci->l1_bytes, sys.l1_bytes)) ci->l1_bytes = sys.l1_bytes;
+    if (cp_off_sysfs(ci->l2_bytes, sys.l2_bytes)) ci->l2_bytes = sys.l2_bytes;
+    if (cp_off_sysfs(ci->l3_bytes, sys.l3_bytes)) ci->l3_bytes = sys.l3_bytes;
+
+    /* Line size: forward chase with growing stride over a 4x L2 buffer;
+     * cost per load stops growing once every load touches a new line. */
+    size_t lbytes = (ci->l2_bytes ? ci->l2_bytes : (256u << 10)) * 4;
+    char *lb = (char *)cp_map(lbytes, 1);
+    if (lb) {
+        double prev = 0.0;
+        size_t line = 0;
+        for (size_t s = 8; s <= 512; s *= 2) {
+            size_t cnt = lbytes / s;
+            for (size_t i = 0; i < cnt; i++)
+                *(void **)(lb + i * s) = (void *)(lb + ((i + 1) % cnt) * s);
+            void *p = lb;
+            long loads = 1L << 20;
+            double t0 = cp_now_ns();
+            for (long i = 0; i < loads; i++) p = *(void **)p;
+            double t = (cp_now_ns() - t0) / loads;
+            *(void *volatile *)&lb[8] = p;
+            if (prev > 0.0 && t < prev * 1.25 && !line) line = s / 2;
+            prev = t;
+        }
+        munmap(lb, lbytes);
+        if (line >= 32 && line <= 256) ci->line_size = line;
+    }
+
+    /* TLB reach: one node per 4K page, offset rotated so lines spread over sets */
+    size_t tsizes[CACHE_PROBE_MAX_POINTS];
+    double tlat[CACHE_PROBE_MAX_POINTS];
+    int tn = 0;
+    size_t max_pages = 8192;
+    char *tb = (char *)cp_map(max_pages * 4096, 0);
+    if (tb) {
+        for (size_t pages = 16; pages <= max_pages && tn < CACHE_PROBE_MAX_POINTS; pages *= 2) {
+            tsizes[tn] = pages * 4096;
+            tlat[tn] = cp_chase(tb, pages, 4096, 64 * 7, 1L << 19);
+            tn++;
+        }
+        munmap(tb, max_pages * 4096);
+        size_t tk[2] = {0, 0};
+        int nt = cp_knees(tsizes, tlat, tn, 1.3, tk, NULL, 2);
+        if (nt >= 1) ci->dtlb_reach = tk[0];
+        if (nt >= 2) ci->stlb_reach = tk[1];
+    }
+
+    /* Bandwidth per level: half of each capacity, DRAM at 4x LLC (capped) */
+    ci->bw_gbs[0] = cp_read_bw(ci->l1_bytes / 2);
+    ci->bw_gbs[1] = cp_read_bw(ci->l2_bytes / 2);
+    if (ci->l3_bytes) ci->bw_gbs[2] = cp_read_bw(ci->l3_bytes / 2 < (32u << 20) ? ci->l3_bytes / 2 : (32u << 20));
+    size_t dram_ws = ci->l3_bytes ? ci->l3_bytes * 4 : (size_t)256 << 20;
+    if (dram_ws > ((size_t)512 << 20)) dram_ws = (size_t)512 << 20;
+    ci->bw_gbs[3] = cp_read_bw(dram_ws);
+
+    ci->measured = 1;
+}
+
+static inline void cp_cache_path(char *path, size_t len) {
+    const char *env = getenv("HPC_CACHE_PROBE_FILE");
+    if (env && *env) { snprintf(path, len, "%s", env); return; }
+    char host[64] = "localhost";
+    gethostname(host, sizeof(host) - 1);
+    snprintf(path, len, "/tmp/hpc_cache_probe.%s", host);
+}
+
+static inline int cp_load(cache_info_t *ci, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    memset(ci, 0, sizeof(*ci));
+    int got = fscanf(f, "line_size=%zu l1=%zu l2=%zu l3=%zu dtlb_reach=%zu stlb_reach=%zu "
+                        "lat=%lf,%lf,%lf,%lf bw=%lf,%lf,%lf,%lf",
+                     &ci->line_size, &ci->l1_bytes, &ci->l2_bytes, &ci->l3_bytes,
+                     &ci->dtlb_reach, &ci->stlb_reach,
+                     &ci->lat_ns[0], &ci->lat_ns[1], &ci->lat_ns[2], &ci->lat_ns[3],
+                     &ci->bw_gbs[0], &ci->bw_gbs[1], &ci->bw_gbs[2], &ci->bw_gbs[3]);
+    fclose(f);
+    ci->measured = 1;
+    return got == 14;
+}
+
+static inline void cp_save(const cache_info_t *ci, const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) return;
+    fprintf(f, "line_size=%zu l1=%zu l2=%zu l3=%zu dtlb_reach=%zu stlb_reach=%zu "
+               "lat=%.3f,%.3f,%.3f,%.3f bw=%.3f,%.3f,%.3f,%.3f\n",
+            ci->line_size, ci->l1_bytes, ci->l2_bytes, ci->l3_bytes,
+            ci->dtlb_reach, ci->stlb_reach,
+            ci->lat_ns[0], ci->lat_ns[1], ci->lat_ns[2], ci->lat_ns[3],
+            ci->bw_gbs[0], ci->bw_gbs[1], ci->bw_gbs[2], ci->bw_gbs[3]);
+    fclose(f);
+}
+
+/* Host cache parameters: cached file, else probe (and cache), else sysfs. */
+static inline void cache_probe_host(cache_info_t *ci) {
+    const char *off = getenv("HPC_CACHE_PROBE");
+    if (off && strcmp(off, "0") == 0) { cp_fill_sysfs(ci); return; }
+    char path[256];
+    cp_cache_path(path, sizeof(path));
+    const char *re = getenv("HPC_REPROBE");
+    if (!(re && strcmp(re, "1") == 0) && cp_load(ci, path)) {
+        /* a file written before every level was checked against sysfs may
+         * hold a mis-detected knee: probe again then */
+        cache_info_t sys;
+        cp_fill_sysfs(&sys);
+        if (!cp_off_sysfs(ci->l1_bytes, sys.l1_bytes) && !cp_off_sysfs(ci->l2_bytes, sys.l2_bytes) &&
+            !cp_off_sysfs(ci->l3_bytes, sys.l3_bytes))
+            return;
+    }
+    cache_probe_measure(ci);
+    if (ci->measured) cp_save(ci, path);
+}
+
+static inline int cp_pow2_floor(size_t v) {
+    int p = 1;
+    while ((size_t)p * 2 <= v) p *= 2;
+    return p;
+}
+
+/* Square tile edge (doubles) so that `nmats` tiles fit in L1 together,
+ * rounded down to a power of two and clamped to [8, 256]. */
+static inline int cache_tile_square(const cache_info_t *ci, int nmats) {
+    const char *env = getenv("HPC_TILE");
+    if (env && atoi(env) > 0) return atoi(env);
+    size_t per = ci->l1_bytes / (size_t)(nmats * sizeof(double));
+    int t = cp_pow2_floor((size_t)sqrt((double)per));
+    if (t < 8) t = 8;
+    if (t > 256) t = 256;
+    return t;
+}
+
+/* Square tile edge for row-blocked GEMV (pattern4): the x chunk should sit
+ * in half of L1, and the rows of one tile (one 4K page each for large N)
+ * should stay within first-level TLB reach. */
+static inline int cache_tile_gemv(const cache_info_t *ci) {
+    const char *env = getenv("HPC_TILE");
+    if (env && atoi(env) > 0) return atoi(env);
+    int by_l1 = cp_pow2_floor(ci->l1_bytes / 2 / sizeof(double));
+    int by_tlb = cp_pow2_floor(ci->dtlb_reach / 4096);
+    int t = by_l1 < by_tlb ? by_l1 : by_tlb;
+    return t < 16 ? 16 : t;
+}
+
+/*
+ * Length of the x chunk a register-blocked GEMV keeps resident in a cache of
+ * level_bytes: half the level, leaving the other half to the streamed rows
+ * of A. Rounded down to a multiple of 8 doubles.
+ */
+static inline int cache_xblock(size_t level_bytes) {
+    long n = (long)(level_bytes / 2 / sizeof(double)) & ~7L;
+    if (n < 64) n = 64;
+    return n > (1L << 30) ? (1 << 30) : (int)n;
+}
+
+static inline void cache_probe_print(FILE *out, const cache_info_t *ci) {
+    fprintf(out, "cache: %s line=%zuB L1=%zuK L2=%zuK L3=%zuK dTLB reach=%zuK sTLB reach=%zuK\n",
+            ci->measured ? "measured" : "sysfs", ci->line_size,
+            ci->l1_bytes >> 10, ci->l2_bytes >> 10, ci->l3_bytes >> 10,
+            ci->dtlb_reach >> 10, ci->stlb_reach >> 10);
+    if (ci->measured)
+        fprintf(out, "       latency ns L1=%.2f L2=%.2f L3=%.2f DRAM=%.2f | read GB/s L1=%.1f L2=%.1f L3=%.1f DRAM=%.1f\n",
+                ci->lat_ns[0], ci->lat_ns[1], ci->lat_ns[2], ci->lat_ns[3],
+                ci->bw_gbs[0], ci->bw_gbs[1], ci->bw_gbs[2], ci->bw_gbs[3]);
+}
+
+#endif
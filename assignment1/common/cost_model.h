@@ -0,0 +1,182 @@
+/*
+ * cost_model.h - grain-size cutoff: how many threads a kernel call should use
+ *
+ * Splitting a call over t threads saves at most (t-1)/t of its work but
+ * pays a fixed cost per extra thread, so a 256x256 add on 16 threads is
+ * slower than on one. The model predicts
+ *
+ *   time(t) = work_ns / min(t, cores) + per_thread_ns * (t - 1)
+ *
+ * and hpc_auto_threads picks the t in 1..max with the smallest prediction
+ * (the fewest threads on a tie). work_ns comes from hpc_cost_work_ns: the
+ * larger of flops * flop_ns and bytes over the single-thread bandwidth of
+ * the cache level the footprint fits in (from cache_probe.h). per_thread_ns
+ * is what one more thread costs the caller's dispatch scheme:
+ *   spawn_ns     pthread_create + pthread_join of one empty thread
+ *   barrier_ns   one hybrid-barrier episode with one more participant
+ * Shared-bandwidth saturation is not modelled; past the core count only
+ * the overhead grows.
+ *
+ * The per-host constants are calibrated once (~20 ms) and cached in
+ * /tmp/hpc_cost_model.<hostname> (override with HPC_COST_MODEL_FILE).
+ *   HPC_RECALIBRATE=1   ignore the cached file and measure again
+ *   HPC_AUTO_THREADS=0  always use the requested thread count
+ *
+ * Header-only, usable from both C and C++.
+ */
+#ifndef HPC_COST_MODEL_H
+#define HPC_COST_MODEL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "cache_probe.h"
+#include "barriers.h"
+
+typedef struct {
+    double spawn_ns;        /* create + join of one thread */
+    double barrier_ns;      /* barrier episode cost per extra participant */
+    double flop_ns;         /* one double add/mul, independent chains */
+    int cores;
+    cache_info_t cache;     /* level sizes and bandwidths */
+} hpc_cost_model_t;
+
+static inline void *hpc_cm_empty(void *v) { return v; }
+
+typedef struct {
+    hpc_barrier_t *bar;
+    int episodes;
+} hpc_cm_bar_arg;
+
+static inline void *hpc_cm_bar_worker(void *v) {
+    hpc_cm_bar_arg *a = (hpc_cm_bar_arg *)v;
+    for (int e = 0; e < a->episodes; e++) hpc_barrier_wait(a->bar, 1);
+    return NULL;
+}
+
+static inline double hpc_cm_spawn_ns(void) {
+    double best = 1e30;
+    for (int r = 0; r < 50; r++) {
+        pthread_t th;
+        double t0 = cp_now_ns();
+        pthread_create(&th, NULL, hpc_cm_empty, NULL);
+        pthread_join(th, NULL);
+        double dt = cp_now_ns() - t0;
+        if (dt < best) best = dt;
+    }
+    return best;
+}
+
+/* Per-episode cost of a 2-thread hybrid barrier, i.e. of one extra waiter */
+static inline double hpc_cm_barrier_ns(void) {
+    const int episodes = 2000;
+    hpc_barrier_t bar;
+    if (hpc_barrier_init(&bar, HPC_BAR_HYBRID, 2) != 0) return 0.0;
+    hpc_cm_bar_arg arg = {&bar, episodes};
+    pthread_t th;
+    pthread_create(&th, NULL, hpc_cm_bar_worker, &arg);
+    hpc_barrier_wait(&bar, 0);   /* partner is up */
+    double t0 = cp_now_ns();
+    for (int e = 1; e < episodes; e++) hpc_barrier_wait(&bar, 0);
+    double dt = cp_now_ns() - t0;
+    pthread_join(th, NULL);
+    hpc_barrier_destroy(&bar);
+    return dt / (episodes - 1);
+}
+
+static inline double hpc_cm_flop_ns(void) {
+    const long n = 1 << 20;
+    double best = 1e30;
+    double s[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    for (int r = 0; r < 3; r++) {
+        double t0 = cp_now_ns();
+        for (long i = 0; i < n; i++)
+            for (int u = 0; u < 8; u++) s[u] = s[u] * 0.999999 + 1e-9;
+        double dt = cp_now_ns() - t0;
+        if (dt < best) best = dt;
+    }
+    volatile double sink = s[0] + s[7];
+    (void)sink;
+    return best / (n * 8 * 2.0);
+}
+
+static inline void hpc_cm_path(char *path, size_t len) {
+    const char *env = getenv("HPC_COST_MODEL_FILE");
+    if (env && *env) { snprintf(path, len, "%s", env); return; }
+    char host[64] = "localhost";
+    gethostname(host, sizeof(host) - 1);
+    snprintf(path, len, "/tmp/hpc_cost_model.%s", host);
+}
+
+static inline int hpc_cm_load(hpc_cost_model_t *m, const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    int got = fscanf(f, "spawn_ns=%lf barrier_ns=%lf flop_ns=%lf",
+                     &m->spawn_ns, &m->barrier_ns, &m->flop_ns);
+    fclose(f);
+    return got == 3 && m->flop_ns > 0.0;
+}
+
+static inline void hpc_cm_save(const hpc_cost_model_t *m, const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) return;
+    fprintf(f, "spawn_ns=%.1f barrier_ns=%.1f flop_ns=%.4f\n", m->spawn_ns, m->barrier_ns, m->flop_ns);
+    fclose(f);
+}
+
+/* Host model: cached file, else calibrate (and cache). Computed once per process. */
+static inline const hpc_cost_model_t *hpc_cost_model(void) {
+    static hpc_cost_model_t m;
+    static int ready = 0;
+    if (ready) return &m;
+    memset(&m, 0, sizeof(m));
+    m.cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (m.cores < 1) m.cores = 1;
+    cache_probe_host(&m.cache);
+    char path[256];
+    hpc_cm_path(path, sizeof(path));
+    const char *re = getenv("HPC_RECALIBRATE");
+    if ((re && strcmp(re, "1") == 0) || !hpc_cm_load(&m, path)) {
+        m.spawn_ns = hpc_cm_spawn_ns();
+        m.barrier_ns = hpc_cm_barrier_ns();
+        m.flop_ns = hpc_cm_flop_ns();
+        hpc_cm_save(&m, path);
+    }
+    ready = 1;
+    return &m;
+}
+
+/* Single-thread time estimate for flops operations streaming bytes over a
+ * working set of footprint bytes */
+static inline double hpc_cost_work_ns(const hpc_cost_model_t *m, double flops, double bytes,
+                                      double footprint) {
+    const cache_info_t *c = &m->cache;
+    int level = footprint <= c->l1_bytes ? 0 : footprint <= c->l2_bytes ? 1
+              : (c->l3_bytes && footprint <= c->l3_bytes) ? 2 : 3;
+    double bw = 0.0;   /* GB/s = bytes per ns */
+    for (int l = level; l < 4 && bw <= 0.0; l++) bw = c->bw_gbs[l];
+    if (bw <= 0.0) bw = 10.0;   /* probe disabled: a typical DRAM stream */
+    double mem = bytes / bw;
+    double cpu = flops * m->flop_ns;
+    return mem > cpu ? mem : cpu;
+}
+
+/* Threads (1..max_threads) that minimize the predicted time */
+static inline int hpc_auto_threads(const hpc_cost_model_t *m, double work_ns, double per_thread_ns,
+                                   int max_threads) {
+    const char *env = getenv("HPC_AUTO_THREADS");
+    if (max_threads <= 1 || (env && strcmp(env, "0") == 0)) return max_threads;
+    int best_t = 1;
+    double best = work_ns;
+    for (int t = 2; t <= max_threads; t++) {
+        int eff = t < m->cores ? t : m->cores;
+        double pred = work_ns / eff + per_thread_ns * (t - 1);
+        if (pred < best) { best = pred; best_t = t; }
+    }
+    return best_t;
+}
+
+#endif
@@ -0,0 +1,147 @@
+/*
+ * cpufreq.h - effective core clock over timed regions
+ *
+ * Turbo and thermal throttling change the clock between a 1-thread and a
+ * 16-thread run, so seconds alone do not compare. Bracket a timed region
+ * with hpc_freq_begin / hpc_freq_end (like hpc_faults_*) to get
+ *   ghz        average clock while the region's threads were running
+ *   cycles     core cycles spent by all of them
+ *   turbo      cycles / ref-cycles: above 1 is turbo, below 1 throttling
+ *              (the APERF/MPERF ratio, without MSR access)
+ * so callers can report cycles per element and flops per cycle.
+ *
+ * Sources, best first:
+ *   perf   cycles, ref-cycles and task-clock from perf_event_open, user
+ *          space only (works at perf_event_paranoid <= 2), with inherit so
+ *          the caller's threads are counted too
+ *   probe  no hardware counters (VMs, containers): a chain of dependent
+ *          integer adds, one cycle each, timed before and after the region;
+ *          cycles = ghz * task-clock. turbo is nan.
+ *   none   neither: everything is nan
+ * HPC_FREQ=probe forces the probe, HPC_FREQ=0 turns both off.
+ *
+ * A read sums the inherited counts of every thread created after the
+ * counters were opened, running or exited; threads that existed before
+ * are not counted at all. Callers that start workers ahead of
+ * hpc_freq_begin, persistent pools (libhpcmat contexts) above all, call
+ * hpc_freq_counters() before creating them.
+ *
+ * Header-only, usable from both C and C++.
+ */
+#ifndef HPC_CPUFREQ_H
+#define HPC_CPUFREQ_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+typedef enum { HPC_FREQ_NONE = 0, HPC_FREQ_PROBE, HPC_FREQ_PERF } hpc_freq_source;
+
+static const char *const hpc_freq_sources[3] = {"none", "probe", "perf"};
+
+typedef struct {
+    uint64_t cycles, ref_cycles, task_ns;   /* snapshots, then deltas */
+    double probe_ghz;                       /* probe taken at begin */
+    double ghz;
+    double turbo;
+    double total_cycles;
+    double cpu_sec;                         /* CPU time of all threads */
+    hpc_freq_source source;
+} hpc_freq_t;
+
+typedef struct {
+    int fd_cycles, fd_ref, fd_task;
+    hpc_freq_source source;
+} hpc_freq_counters_t;
+
+static inline int hpc_freq_open(uint32_t type, uint64_t config) {
+    struct perf_event_attr a;
+    memset(&a, 0, sizeof(a));
+    a.type = type;
+    a.size = sizeof(a);
+    a.config = config;
+    a.exclude_kernel = 1;
+    a.exclude_hv = 1;
+    a.inherit = 1;
+    return (int)syscall(SYS_perf_event_open, &a, 0, -1, -1, 0);
+}
+
+static inline uint64_t hpc_freq_read(int fd) {
+    uint64_t v = 0;
+    if (fd >= 0 && read(fd, &v, sizeof(v)) != (ssize_t)sizeof(v)) v = 0;
+    return v;
+}
+
+/* Counters opened once per process; they run from then on */
+static inline const hpc_freq_counters_t *hpc_freq_counters(void) {
+    static hpc_freq_counters_t c = {-1, -1, -1, HPC_FREQ_NONE};
+    static int ready = 0;
+    if (ready) return &c;
+    ready = 1;
+    const char *env = getenv("HPC_FREQ");
+    if (env && strcmp(env, "0") == 0) return &c;
+    c.fd_task = hpc_freq_open(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK);
+    if (!(env && strcmp(env, "probe") == 0)) {
+        c.fd_cycles = hpc_freq_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        c.fd_ref = hpc_freq_open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_REF_CPU_CYCLES);
+    }
+    if (c.fd_cycles >= 0 && c.fd_task >= 0) c.source = HPC_FREQ_PERF;
+#if defined(__x86_64__) || defined(__i386__)
+    else if (c.fd_task >= 0) c.source = HPC_FREQ_PROBE;
+#endif
+    return &c;
+}
+
+/* Clock of the calling core (GHz) from a dependent add chain, ~1 ms */
+static inline double hpc_freq_probe_ghz(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    const long iters = 250000;
+    uint64_t x = 0, one = 1;
+    struct timespec a, b;
+    clock_gettime(CLOCK_MONOTONIC, &a);
+    for (long i = 0; i < iters; i++)
+        /* register operands: newer cores fold add-immediate chains at rename */
+        __asm__ __volatile__("add %1, %0\n\tadd %1, %0\n\tadd %1, %0\n\tadd %1, %0\n\t"
+                             "add %1, %0\n\tadd %1, %0\n\tadd %1, %0\n\tadd %1, %0" : "+r"(x) : "r"(one));
+    clock_gettime(CLOCK_MONOTONIC, &b);
+    double ns = (b.tv_sec - a.tv_sec) * 1e9 + (b.tv_nsec - a.tv_nsec);
+    return ns > 0 ? iters * 8.0 / ns : NAN;
+#else
+    return NAN;
+#endif
+}
+
+static inline void hpc_freq_begin(hpc_freq_t *f) {
+    const hpc_freq_counters_t *c = hpc_freq_counters();
+    memset(f, 0, sizeof(*f));
+    f->source = c->source;
+    if (c->source == HPC_FREQ_PROBE) f->probe_ghz = hpc_freq_probe_ghz();
+    f->cycles = hpc_freq_read(c->fd_cycles);
+    f->ref_cycles = hpc_freq_read(c->fd_ref);
+    f->task_ns = hpc_freq_read(c->fd_task);
+}
+
+static inline void hpc_freq_end(hpc_freq_t *f) {
+    const hpc_freq_counters_t *c = hpc_freq_counters();
+    f->cycles = hpc_freq_read(c->fd_cycles) - f->cycles;
+    f->ref_cycles = hpc_freq_read(c->fd_ref) - f->ref_cycles;
+    f->task_ns = hpc_freq_read(c->fd_task) - f->task_ns;
+    f->cpu_sec = c->fd_task >= 0 ? f->task_ns * 1e-9 : NAN;
+    f->ghz = f->turbo = f->total_cycles = NAN;
+    if (f->source == HPC_FREQ_PERF && f->task_ns) {
+        f->total_cycles = (double)f->cycles;
+        f->ghz = (double)f->cycles / f->task_ns;
+        if (c->fd_ref >= 0 && f->ref_cycles) f->turbo = (double)f->cycles / f->ref_cycles;
+    } else if (f->source == HPC_FREQ_PROBE) {
+        f->ghz = (f->probe_ghz + hpc_freq_probe_ghz()) / 2.0;
+        f->total_cycles = f->ghz * f->task_ns;
+    }
+}
+
+#endif
@@ -0,0 +1,27 @@
+// Standalone environment fingerprint for scripts whose CSV comes from a
+// program's stdout: writes <csv>.meta.json (see fingerprint.h) and warns
+// about a noisy machine on stderr. The compiler line is taken from
+// "<compiler> --version", so it names what built the benchmark.
+// Build: gcc -O2 fingerprint.c -o fingerprint
+// Usage: ./fingerprint results.csv "$CC" "$CFLAGS"
+#include "fingerprint.h"
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <csv> [compiler] [cflags]\n", argv[0]);
+        return 2;
+    }
+    char version[128] = "";
+    if (argc > 2) {
+        char cmd[256];
+        snprintf(cmd, sizeof(cmd), "%s --version 2>/dev/null", argv[2]);
+        FILE *p = popen(cmd, "r");
+        if (p) {
+            if (fgets(version, sizeof(version), p)) version[strcspn(version, "\n")] = '\0';
+            pclose(p);
+        }
+        if (!version[0]) snprintf(version, sizeof(version), "%s", argv[2]);
+    }
+    hpc_fingerprint_sidecar(argv[1], version, argc > 3 ? argv[3] : NULL);
+    return 0;
+}
@@ -0,0 +1,232 @@
+/*
+ * fingerprint.h - the environment a result was measured in
+ *
+ * Numbers from different setups do not compare: a powersave governor, SMT
+ * siblings, transparent huge pages or -O2 instead of -O3 move them more
+ * than most code changes do. hpc_fingerprint_sidecar("results.csv", ...)
+ * writes results.csv.meta.json next to a result file with
+ *   host, kernel, cpu_model, logical_cpus, physical_cores, smt,
+ *   governor, no_turbo, thp, compiler, cflags, loadavg, running, date
+ * and returns the number of noise warnings it printed to stderr (they are
+ * also listed in the sidecar):
+ *   - a governor other than performance (powersave clocks down between
+ *     runs; ondemand/schedutil need time to ramp up)
+ *   - other runnable processes, or a 1-minute load average above 1
+ *
+ * Programs that write their own CSV call it with their build flags:
+ * HPC_CFLAGS is passed by the scripts (-DHPC_CFLAGS="\"$CFLAGS\""),
+ * HPC_COMPILER_ID is the compiler that built the caller. Scripts whose
+ * CSV comes from stdout use the fingerprint tool (fingerprint.c).
+ * Fields that cannot be read (no cpufreq in VMs, no smt file on old
+ * kernels) are "unknown".
+ *
+ * Header-only, usable from both C and C++.
+ */
+#ifndef HPC_FINGERPRINT_H
+#define HPC_FINGERPRINT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+
+#ifndef HPC_CFLAGS
+#define HPC_CFLAGS "unknown"
+#endif
+
+#if defined(__clang__)
+#define HPC_COMPILER_ID "clang " __clang_version__
+#elif defined(__GNUC__)
+#define HPC_COMPILER_ID "gcc " __VERSION__
+#else
+#define HPC_COMPILER_ID "unknown"
+#endif
+
+#define HPC_FP_WARN_MAX 4
+
+typedef struct {
+    char host[65];
+    char kernel[65];
+    char cpu_model[128];
+    int logical_cpus;
+    int physical_cores;         /* distinct (package, core) pairs; 0 = unknown */
+    char smt[16];               /* on / off / unknown */
+    char governor[32];
+    char no_turbo[16];
+    char thp[32];               /* the selected mode of transparent_hugepage */
+    char compiler[128];
+    char cflags[256];
+    double loadavg;
+    int running;                /* runnable tasks besides the caller */
+    char date[32];              /* UTC, ISO 8601 */
+    int nwarn;
+    char warn[HPC_FP_WARN_MAX][128];
+} hpc_fingerprint_t;
+
+/* First line of a sysfs/procfs file, newline stripped; 0 if unreadable */
+static inline int hpc_fp_read_line(const char *path, char *out, size_t len) {
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    int ok = fgets(out, (int)len, f) != NULL;
+    fclose(f);
+    if (ok) out[strcspn(out, "\n")] = '\0';
+    return ok;
+}
+
+static inline void hpc_fp_add_warning(hpc_fingerprint_t *fp, const char *msg) {
+    if (fp->nwarn < HPC_FP_WARN_MAX)
+        snprintf(fp->warn[fp->nwarn++], sizeof(fp->warn[0]), "%s", msg);
+}
+
+static inline void hpc_fingerprint(hpc_fingerprint_t *fp, const char *compiler, const char *cflags) {
+    memset(fp, 0, sizeof(*fp));
+    struct utsname u;
+    if (uname(&u) == 0) {
+        snprintf(fp->host, sizeof(fp->host), "%s", u.nodename);
+        snprintf(fp->kernel, sizeof(fp->kernel), "%s", u.release);
+    }
+    snprintf(fp->compiler, sizeof(fp->compiler), "%s", compiler && *compiler ? compiler : "unknown");
+    snprintf(fp->cflags, sizeof(fp->cflags), "%s", cflags && *cflags ? cflags : "unknown");
+    fp->logical_cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    /* model name, and cores from distinct (physical id, core id) pairs */
+    snprintf(fp->cpu_model, sizeof(fp->cpu_model), "unknown");
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if (f) {
+        char line[256];
+        int phys = 0;
+        int seen[1024];
+        int nseen = 0;
+        while (fgets(line, sizeof(line), f)) {
+            char *colon = strchr(line, ':');
+            if (!colon) continue;
+            if (strncmp(line, "model name", 10) == 0 && strcmp(fp->cpu_model, "unknown") == 0) {
+                char *v = colon + 1;
+                while (*v == ' ') v++;
+                v[strcspn(v, "\n")] = '\0';
+                snprintf(fp->cpu_model, sizeof(fp->cpu_model), "%s", v);
+            } else if (strncmp(line, "physical id", 11) == 0) {
+                phys = atoi(colon + 1);
+            } else if (strncmp(line, "core id", 7) == 0) {
+                int key = phys * 4096 + atoi(colon + 1), dup = 0;
+                for (int i = 0; i < nseen && !dup; i++) dup = seen[i] == key;
+                if (!dup && nseen < 1024) seen[nseen++] = key;
+            }
+        }
+        fclose(f);
+        fp->physical_cores = nseen;
+    }
+
+    char buf[128];
+    if (hpc_fp_read_line("/sys/devices/system/cpu/smt/active", buf, sizeof(buf)))
+        snprintf(fp->smt, sizeof(fp->smt), "%s", atoi(buf) ? "on" : "off");
+    else if (fp->physical_cores)
+        snprintf(fp->smt, sizeof(fp->smt), "%s", fp->logical_cpus > fp->physical_cores ? "on" : "off");
+    else
+        snprintf(fp->smt, sizeof(fp->smt), "unknown");
+
+    if (!hpc_fp_read_line("/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor", fp->governor, sizeof(fp->governor)))
+        snprintf(fp->governor, sizeof(fp->governor), "unknown");
+    if (hpc_fp_read_line("/sys/devices/system/cpu/intel_pstate/no_turbo", buf, sizeof(buf)))
+        snprintf(fp->no_turbo, sizeof(fp->no_turbo), "%d", atoi(buf));
+    else if (hpc_fp_read_line("/sys/devices/system/cpu/cpufreq/boost", buf, sizeof(buf)))
+        snprintf(fp->no_turbo, sizeof(fp->no_turbo), "%d", !atoi(buf));     /* acpi-cpufreq: the inverse */
+    else
+        snprintf(fp->no_turbo, sizeof(fp->no_turbo), "unknown");
+
+    /* "always [madvise] never": keep the bracketed mode */
+    snprintf(fp->thp, sizeof(fp->thp), "unknown");
+    if (hpc_fp_read_line("/sys/kernel/mm/transparent_hugepage/enabled", buf, sizeof(buf))) {
+        char *l = strchr(buf, '['), *r = l ? strchr(l, ']') : NULL;
+        if (l && r) { *r = '\0'; snprintf(fp->thp, sizeof(fp->thp), "%s", l + 1); }
+    }
+
+    /* /proc/loadavg: "0.12 0.30 0.25 2/345 6789", runnable count includes us */
+    fp->loadavg = -1.0;
+    if (hpc_fp_read_line("/proc/loadavg", buf, sizeof(buf))) {
+        int r = 0, t = 0;
+        if (sscanf(buf, "%lf %*f %*f %d/%d", &fp->loadavg, &r, &t) == 3) fp->running = r > 1 ? r - 1 : 0;
+    }
+
+    time_t now = time(NULL);
+    struct tm tm;
+    gmtime_r(&now, &tm);
+    strftime(fp->date, sizeof(fp->date), "%Y-%m-%dT%H:%M:%SZ", &tm);
+
+    char msg[128];
+    if (strcmp(fp->governor, "unknown") != 0 && strcmp(fp->governor, "performance") != 0) {
+        snprintf(msg, sizeof(msg), "cpufreq governor is %s, not performance", fp->governor);
+        hpc_fp_add_warning(fp, msg);
+    }
+    if (fp->running > 0) {
+        snprintf(msg, sizeof(msg), "%d other runnable process(es)", fp->running);
+        hpc_fp_add_warning(fp, msg);
+    }
+    if (fp->loadavg > 1.0) {
+        snprintf(msg, sizeof(msg), "1-minute load average is %.2f", fp->loadavg);
+        hpc_fp_add_warning(fp, msg);
+    }
+}
+
+/* JSON string: quotes, backslashes and control characters escaped */
+static inline void hpc_fp_json_escape(FILE *f, const char *v) {
+    fputc('"', f);
+    for (const char *p = v; *p; p++) {
+        if (*p == '"' || *p == '\\') fprintf(f, "\\%c", *p);
+        else if ((unsigned char)*p < 0x20) fprintf(f, "\\u%04x", *p);
+        else fputc(*p, f);
+    }
+    fputc('"', f);
+}
+
+static inline void hpc_fp_json_str(FILE *f, const char *key, const char *v) {
+    fprintf(f, "  \"%s\": ", key);
+    hpc_fp_json_escape(f, v);
+    fprintf(f, ",\n");
+}
+
+static inline void hpc_fingerprint_json(FILE *f, const hpc_fingerprint_t *fp) {
+    fprintf(f, "{\n");
+    hpc_fp_json_str(f, "host", fp->host);
+    hpc_fp_json_str(f, "kernel", fp->kernel);
+    hpc_fp_json_str(f, "cpu_model", fp->cpu_model);
+    fprintf(f, "  \"logical_cpus\": %d,\n", fp->logical_cpus);
+    fprintf(f, "  \"physical_cores\": %d,\n", fp->physical_cores);
+    hpc_fp_json_str(f, "smt", fp->smt);
+    hpc_fp_json_str(f, "governor", fp->governor);
+    hpc_fp_json_str(f, "no_turbo", fp->no_turbo);
+    hpc_fp_json_str(f, "thp", fp->thp);
+    hpc_fp_json_str(f, "compiler", fp->compiler);
+    hpc_fp_json_str(f, "cflags", fp->cflags);
+    fprintf(f, "  \"loadavg\": %.2f,\n", fp->loadavg);
+    fprintf(f, "  \"running\": %d,\n", fp->running);
+    hpc_fp_json_str(f, "date", fp->date);
+    fprintf(f, "  \"warnings\": [");
+    for (int i = 0; i < fp->nwarn; i++) {
+        fprintf(f, "%s", i ? ", " : "");
+        hpc_fp_json_escape(f, fp->warn[i]);
+    }
+    fprintf(f, "]\n}\n");
+}
+
+/* Write <csv_path>.meta.json and warn on stderr; returns the warning count */
+static inline int hpc_fingerprint_sidecar(const char *csv_path, const char *compiler, const char *cflags) {
+    hpc_fingerprint_t fp;
+    hpc_fingerprint(&fp, compiler, cflags);
+    char path[512];
+    snprintf(path, sizeof(path), "%s.meta.json", csv_path);
+    FILE *f = fopen(path, "w");
+    if (f) {
+        hpc_fingerprint_json(f, &fp);
+        fclose(f);
+    } else {
+        fprintf(stderr, "fingerprint: cannot write %s\n", path);
+    }
+    for (int i = 0; i < fp.nwarn; i++)
+        fprintf(stderr, "warning: noisy environment: %s\n", fp.warn[i]);
+    return fp.nwarn;
+}
+
+#endif
@@ -0,0 +1,135 @@
+/*
+ * hdr_hist.h - HDR-style latency histograms, recorded in-process
+ *
+ * One number per configuration hides the jitter of individual operations,
+ * which dominates small matrices. An hpc_hist_t records every operation's
+ * latency (ns) in log-linear buckets, the HdrHistogram layout: values below
+ * 2 * HPC_HIST_SUB are exact, above that every power of two is split into
+ * HPC_HIST_SUB linear buckets, so a recorded value is off by less than
+ * 1 / HPC_HIST_SUB (0.8%) anywhere from 1 ns to centuries. The counts are
+ * a fixed array, so hpc_hist_record never allocates; it is two relaxed
+ * atomic increments plus min/max compare-and-swaps that almost never
+ * retry, so any number of threads record into one histogram without a
+ * lock.
+ *
+ * Read it after the recording threads are joined:
+ *   hpc_hist_percentile(h, 99.9)   value at a percentile (bucket midpoint)
+ *   hpc_hist_write(h, f, scale)    HdrHistogram's percentile distribution
+ *                                  text (.hgrm), readable by its plotters
+ *
+ * Header-only, usable from both C and C++.
+ */
+#ifndef HPC_HDR_HIST_H
+#define HPC_HDR_HIST_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#define HPC_HIST_SUB_BITS 7
+#define HPC_HIST_SUB (1 << HPC_HIST_SUB_BITS)     /* linear buckets per power of two */
+#define HPC_HIST_BUCKETS (2 * HPC_HIST_SUB + (64 - HPC_HIST_SUB_BITS - 1) * HPC_HIST_SUB)
+
+typedef struct {
+    uint64_t counts[HPC_HIST_BUCKETS];
+    uint64_t total;
+    uint64_t min, max;
+} hpc_hist_t;
+
+static inline void hpc_hist_reset(hpc_hist_t *h) {
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+static inline int hpc_hist_index(uint64_t v) {
+    if (v < 2 * HPC_HIST_SUB) return (int)v;
+    int shift = 63 - __builtin_clzll(v) - HPC_HIST_SUB_BITS;      /* v >> shift in [SUB, 2 SUB) */
+    return 2 * HPC_HIST_SUB + (shift - 1) * HPC_HIST_SUB + (int)((v >> shift) - HPC_HIST_SUB);
+}
+
+/* Lowest value of bucket i and its width */
+static inline uint64_t hpc_hist_lowest(int i, uint64_t *width) {
+    if (i < 2 * HPC_HIST_SUB) { *width = 1; return (uint64_t)i; }
+    int shift = (i - 2 * HPC_HIST_SUB) / HPC_HIST_SUB + 1;
+    uint64_t sub = (uint64_t)((i - 2 * HPC_HIST_SUB) % HPC_HIST_SUB) + HPC_HIST_SUB;
+    *width = 1ULL << shift;
+    return sub << shift;
+}
+
+static inline void hpc_hist_record(hpc_hist_t *h, uint64_t v) {
+    __atomic_fetch_add(&h->counts[hpc_hist_index(v)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->total, 1, __ATOMIC_RELAXED);
+    uint64_t cur = __atomic_load_n(&h->min, __ATOMIC_RELAXED);
+    while (v < cur && !__atomic_compare_exchange_n(&h->min, &cur, v, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+    cur = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+    while (v > cur && !__atomic_compare_exchange_n(&h->max, &cur, v, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+}
+
+/* Value at percentile p (0..100): midpoint of the bucket holding that rank,
+ * clamped to the exact min and max; nan when nothing was recorded */
+static inline double hpc_hist_percentile(const hpc_hist_t *h, double p) {
+    if (h->total == 0) return NAN;
+    uint64_t rank = (uint64_t)ceil(p / 100.0 * h->total);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < HPC_HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint64_t width, lo = hpc_hist_lowest(i, &width);
+            double v = lo + (width - 1) / 2.0;
+            if (v < h->min) v = (double)h->min;
+            if (v > h->max) v = (double)h->max;
+            return v;
+        }
+    }
+    return (double)h->max;
+}
+
+static inline double hpc_hist_mean(const hpc_hist_t *h) {
+    if (h->total == 0) return NAN;
+    double s = 0.0;
+    for (int i = 0; i < HPC_HIST_BUCKETS; i++) {
+        if (!h->counts[i]) continue;
+        uint64_t width, lo = hpc_hist_lowest(i, &width);
+        s += h->counts[i] * (lo + (width - 1) / 2.0);
+    }
+    return s / h->total;
+}
+
+static inline double hpc_hist_stddev(const hpc_hist_t *h) {
+    if (h->total == 0) return NAN;
+    double mean = hpc_hist_mean(h), s = 0.0;
+    for (int i = 0; i < HPC_HIST_BUCKETS; i++) {
+        if (!h->counts[i]) continue;
+        uint64_t width, lo = hpc_hist_lowest(i, &width);
+        double d = lo + (width - 1) / 2.0 - mean;
+        s += h->counts[i] * d * d;
+    }
+    return sqrt(s / h->total);
+}
+
+/* HdrHistogram percentile distribution: one line per non-empty bucket,
+ * values divided by scale (1e3 for microseconds) */
+static inline void hpc_hist_write(const hpc_hist_t *h, FILE *f, double scale) {
+    fprintf(f, "%12s %14s %10s %14s\n\n", "Value", "Percentile", "TotalCount", "1/(1-Percentile)");
+    uint64_t seen = 0;
+    for (int i = 0; i < HPC_HIST_BUCKETS && seen < h->total; i++) {
+        if (!h->counts[i]) continue;
+        seen += h->counts[i];
+        uint64_t width, lo = hpc_hist_lowest(i, &width);
+        double v = (lo + width - 1) / scale;
+        double q = (double)seen / h->total;
+        if (seen < h->total)
+            fprintf(f, "%12.3f %2.12f %10llu %14.2f\n", v, q, (unsigned long long)seen, 1.0 / (1.0 - q));
+        else
+            fprintf(f, "%12.3f %2.12f %10llu\n", (double)h->max / scale, q, (unsigned long long)seen);
+    }
+    fprintf(f, "#[Mean    = %12.3f, StdDeviation   = %12.3f]\n", hpc_hist_mean(h) / scale,
+            hpc_hist_stddev(h) / scale);
+    fprintf(f, "#[Max     = %12.3f, Total count    = %12llu]\n", (double)h->max / scale,
+            (unsigned long long)h->total);
+    fprintf(f, "#[Buckets = %12d, SubBuckets     = %12d]\n", HPC_HIST_BUCKETS, HPC_HIST_SUB);
+}
+
+#endif
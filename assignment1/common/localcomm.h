@@ -0,0 +1,419 @@
+/*
+ * localcomm.h - minimal message-passing layer for the distributed kernels
+ *
+ * A small MPI-shaped API (init, split, barrier, broadcast, sum-reduce,
+ * nonblocking broadcast/reduce + wait) with two backends:
+ *
+ *   -DHPC_USE_MPI   thin wrappers over MPI; launch with mpirun -np P.
+ *   (default)       built-in local transport: lc_init forks P ranks that
+ *                   share one anonymous MAP_SHARED region. Broadcasts go
+ *                   through double-buffered slots per communicator,
+ *                   reductions through per-member contribution slots, and
+ *                   every wait spins briefly then sleeps on a shared futex.
+ *
+ * Local transport semantics match MPI's for the calls provided: collective
+ * calls on a communicator must be issued in the same order by all of its
+ * members. Posting is eager - a broadcast root (or reduction contributor)
+ * copies its payload into the shared slot and returns, so it can go on
+ * computing while receivers pick the data up later in lc_wait(). One
+ * outstanding operation per slot pair is buffered; a third post waits for
+ * the oldest one to be consumed.
+ *
+ * Header-only, usable from both C and C++.
+ */
+#ifndef HPC_LOCALCOMM_H
+#define HPC_LOCALCOMM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef HPC_USE_MPI
+#include <mpi.h>
+#else
+#include <signal.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+static inline double lc_wtime(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#ifdef HPC_USE_MPI
+/* ========================================================================
+ * MPI backend
+ * ======================================================================== */
+
+typedef struct { MPI_Comm comm; int rank; int size; } lc_comm;
+typedef struct { MPI_Request req; } lc_request;
+
+static lc_comm lc_world_comm;
+
+static inline int lc_init(int *argc, char ***argv, int nranks, size_t max_msg) {
+    (void)nranks; (void)max_msg;   /* rank count comes from mpirun */
+    MPI_Init(argc, argv);
+    lc_world_comm.comm = MPI_COMM_WORLD;
+    MPI_Comm_rank(MPI_COMM_WORLD, &lc_world_comm.rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &lc_world_comm.size);
+    return lc_world_comm.rank;
+}
+
+static inline lc_comm *lc_world(void) { return &lc_world_comm; }
+
+static inline lc_comm *lc_split(lc_comm *c, int color, int key) {
+    lc_comm *n = (lc_comm *)malloc(sizeof(lc_comm));
+    MPI_Comm_split(c->comm, color, key, &n->comm);
+    MPI_Comm_rank(n->comm, &n->rank);
+    MPI_Comm_size(n->comm, &n->size);
+    return n;
+}
+
+static inline void lc_barrier(lc_comm *c) { MPI_Barrier(c->comm); }
+
+static inline void lc_ibcast(void *buf, size_t bytes, int root, lc_comm *c, lc_request *r) {
+    MPI_Ibcast(buf, (int)bytes, MPI_BYTE, root, c->comm, &r->req);
+}
+
+static inline void lc_ireduce_sum(const double *send, double *recv, size_t n, int root,
+                                  lc_comm *c, lc_request *r) {
+    MPI_Ireduce(send, c->rank == root ? recv : NULL, (int)n, MPI_DOUBLE, MPI_SUM,
+                root, c->comm, &r->req);
+}
+
+static inline void lc_wait(lc_request *r) { MPI_Wait(&r->req, MPI_STATUS_IGNORE); }
+
+static inline void lc_abort(const char *msg) {
+    fprintf(stderr, "abort: %s\n", msg);
+    MPI_Abort(MPI_COMM_WORLD, 1);
+}
+
+static inline int lc_finalize(void) {
+    MPI_Finalize();
+    return 0;
+}
+
+#else
+/* ========================================================================
+ * Local shared-memory backend
+ * ======================================================================== */
+
+#define LC_MAX_RANKS 64
+#define LC_MAX_COMMS 128
+#define LC_SPIN 2000
+
+/* One payload slot; `seq` and `readers` double as futex words. */
+typedef struct {
+    uint32_t seq;        /* number of posts completed into this slot */
+    uint32_t readers;    /* receivers that still have to copy the payload */
+    uint64_t bytes;
+    char pad[48];
+} lc_slot;
+
+typedef struct {
+    int32_t size;
+    uint32_t arrive;
+    uint32_t sense;      /* barrier phase, futex word */
+    int32_t pad0;
+    uint64_t data_off;   /* payload area: (2 + 2*size) * max_msg bytes */
+    char pad1[40];
+    lc_slot bcast[2];
+    lc_slot reduce[2][LC_MAX_RANKS];
+    int32_t xcolor[LC_MAX_RANKS];   /* lc_split exchange area */
+    int32_t xkey[LC_MAX_RANKS];
+    int32_t xid[LC_MAX_RANKS];
+} lc_shared_comm;
+
+typedef struct {
+    uint32_t ncomms;
+    uint32_t aborted;
+    uint64_t arena_used;
+    uint64_t arena_size;
+    uint64_t max_msg;
+    lc_shared_comm comms[LC_MAX_COMMS];
+} lc_shared;
+
+typedef struct {
+    int id;              /* index into lc_shared.comms */
+    int rank;
+    int size;
+    int members[LC_MAX_RANKS];   /* world rank of each member */
+    uint32_t nbcast;     /* collectives issued so far on this comm */
+    uint32_t nreduce;
+    uint32_t sense;
+} lc_comm;
+
+enum { LC_REQ_DONE = 0, LC_REQ_BCAST_RECV = 1, LC_REQ_REDUCE_ROOT = 2 };
+
+typedef struct {
+    int kind;
+    lc_comm *comm;
+    uint32_t op;         /* per-comm sequence number of this collective */
+    void *buf;
+    size_t bytes;
+} lc_request;
+
+static lc_shared *lc_shm;
+static size_t lc_shm_bytes;
+static lc_comm lc_world_comm;
+static int lc_world_rank;
+static pid_t lc_children[LC_MAX_RANKS];
+
+static inline char *lc_payload(uint64_t off) { return (char *)lc_shm + off; }
+
+static inline void lc_abort(const char *msg) {
+    fprintf(stderr, "rank %d abort: %s\n", lc_world_rank, msg);
+    if (lc_shm) __atomic_store_n(&lc_shm->aborted, 1, __ATOMIC_RELEASE);
+    _exit(1);
+}
+
+static inline void lc_futex_wake(uint32_t *word) {
+    syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+/* Block until *word == want. Sleeps with a timeout so a rank that
+ * aborted elsewhere is noticed instead of hanging forever. */
+static inline void lc_wait_eq(uint32_t *word, uint32_t want) {
+    for (int i = 0; i < LC_SPIN; i++)
+        if (__atomic_load_n(word, __ATOMIC_ACQUIRE) == want) return;
+    struct timespec to = {0, 50 * 1000 * 1000};
+    for (;;) {
+        uint32_t v = __atomic_load_n(word, __ATOMIC_ACQUIRE);
+        if (v == want) return;
+        if (__atomic_load_n(&lc_shm->aborted, __ATOMIC_ACQUIRE))
+            lc_abort("peer rank aborted");
+        syscall(SYS_futex, word, FUTEX_WAIT, v, &to, NULL, 0);
+    }
+}
+
+static inline void lc_comm_setup(int id, int size) {
+    lc_shared_comm *sc = &lc_shm->comms[id];
+    uint64_t need = (uint64_t)(2 + 2 * size) * lc_shm->max_msg;
+    uint64_t off = __atomic_fetch_add(&lc_shm->arena_used, need, __ATOMIC_ACQ_REL);
+    if (off + need > lc_shm->arena_size) lc_abort("communicator arena exhausted");
+    sc->size = size;
+    sc->data_off = sizeof(lc_shared) + off;
+}
+
+static inline int lc_init(int *argc, char ***argv, int nranks, size_t max_msg) {
+    (void)argc; (void)argv;
+    if (nranks <= 0) {
+        const char *env = getenv("LC_NP");
+        nranks = env ? atoi(env) : 1;
+    }
+    if (nranks < 1 || nranks > LC_MAX_RANKS) {
+        fprintf(stderr, "lc_init: rank count must be 1..%d\n", LC_MAX_RANKS);
+        exit(1);
+    }
+    max_msg = (max_msg + 63) / 64 * 64;
+    /* Enough payload space for the world plus a row and column communicator
+     * per rank; pages are only backed once touched. */
+    uint64_t arena = (uint64_t)(2 + 2 * nranks) * max_msg * (1 + 2 * (uint64_t)nranks);
+    lc_shm_bytes = sizeof(lc_shared) + arena;
+    void *p = mmap(NULL, lc_shm_bytes, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED) { perror("lc_init mmap"); exit(1); }
+    lc_shm = (lc_shared *)p;
+    lc_shm->arena_size = arena;
+    lc_shm->max_msg = max_msg;
+    lc_shm->ncomms = 1;
+    lc_comm_setup(0, nranks);
+
+    lc_world_comm.id = 0;
+    lc_world_comm.size = nranks;
+    for (int r = 0; r < nranks; r++) lc_world_comm.members[r] = r;
+
+    fflush(stdout);
+    fflush(stderr);
+    int rank = 0;
+    for (int r = 1; r < nranks; r++) {
+        pid_t pid = fork();
+        if (pid < 0) { perror("fork"); lc_abort("fork failed"); }
+        if (pid == 0) {
+            prctl(PR_SET_PDEATHSIG, SIGKILL);
+            rank = r;
+            break;
+        }
+        lc_children[r] = pid;
+    }
+    lc_world_rank = rank;
+    lc_world_comm.rank = rank;
+    return rank;
+}
+
+static inline lc_comm *lc_world(void) { return &lc_world_comm; }
+
+static inline void lc_barrier(lc_comm *c) {
+    lc_shared_comm *sc = &lc_shm->comms[c->id];
+    c->sense = !c->sense;
+    if (__atomic_add_fetch(&sc->arrive, 1, __ATOMIC_ACQ_REL) == (uint32_t)c->size) {
+        __atomic_store_n(&sc->arrive, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&sc->sense, c->sense, __ATOMIC_RELEASE);
+        lc_futex_wake(&sc->sense);
+    } else {
+        lc_wait_eq(&sc->sense, c->sense);
+    }
+}
+
+/* Collective over c: members with equal color form a new communicator,
+ * ranked by (key, parent rank). */
+static inline lc_comm *lc_split(lc_comm *c, int color, int key) {
+    lc_shared_comm *sc = &lc_shm->comms[c->id];
+    sc->xcolor[c->rank] = color;
+    sc->xkey[c->rank] = key;
+    lc_barrier(c);
+
+    int group[LC_MAX_RANKS] = {0}, n = 0;
+    for (int r = 0; r < c->size; r++) {
+        if (sc->xcolor[r] != color) continue;
+        int pos = n++;
+        while (pos > 0 && (sc->xkey[group[pos - 1]] > sc->xkey[r])) {
+            group[pos] = group[pos - 1];
+            pos--;
+        }
+        group[pos] = r;
+    }
+    if (group[0] == c->rank) {
+        int id = (int)__atomic_fetch_add(&lc_shm->ncomms, 1, __ATOMIC_ACQ_REL);
+        if (id >= LC_MAX_COMMS) lc_abort("too many communicators");
+        lc_comm_setup(id, n);
+        sc->xid[c->rank] = id;
+    }
+    lc_barrier(c);
+
+    lc_comm *nc = (lc_comm *)calloc(1, sizeof(lc_comm));
+    nc->id = sc->xid[group[0]];
+    nc->size = n;
+    for (int i = 0; i < n; i++) {
+        nc->members[i] = c->members[group[i]];
+        if (group[i] == c->rank) nc->rank = i;
+    }
+    lc_barrier(c);   /* exchange area may be reused by the next split */
+    return nc;
+}
+
+static inline void lc_ibcast(void *buf, size_t bytes, int root, lc_comm *c, lc_request *r) {
+    uint32_t op = c->nbcast++;
+    r->kind = LC_REQ_DONE;
+    if (c->size == 1) return;
+    if (bytes > lc_shm->max_msg) lc_abort("broadcast larger than max_msg");
+    lc_shared_comm *sc = &lc_shm->comms[c->id];
+    lc_slot *slot = &sc->bcast[op & 1];
+    if (c->rank == root) {
+        lc_wait_eq(&slot->readers, 0);   /* previous payload in this slot consumed */
+        memcpy(lc_payload(sc->data_off + (op & 1) * lc_shm->max_msg), buf, bytes);
+        slot->bytes = bytes;
+        __atomic_store_n(&slot->readers, (uint32_t)(c->size - 1), __ATOMIC_RELAXED);
+        __atomic_store_n(&slot->seq, op / 2 + 1, __ATOMIC_RELEASE);
+        lc_futex_wake(&slot->seq);
+    } else {
+        r->kind = LC_REQ_BCAST_RECV;
+        r->comm = c;
+        r->op = op;
+        r->buf = buf;
+        r->bytes = bytes;
+    }
+}
+
+static inline void lc_ireduce_sum(const double *send, double *recv, size_t n, int root,
+                                  lc_comm *c, lc_request *r) {
+    uint32_t op = c->nreduce++;
+    size_t bytes = n * sizeof(double);
+    r->kind = LC_REQ_DONE;
+    if (bytes > lc_shm->max_msg) lc_abort("reduction larger than max_msg");
+    if (c->rank == root) {
+        if (recv != send) memcpy(recv, send, bytes);
+        if (c->size == 1) return;
+        r->kind = LC_REQ_REDUCE_ROOT;
+        r->comm = c;
+        r->op = op;
+        r->buf = recv;
+        r->bytes = bytes;
+        return;
+    }
+    lc_shared_comm *sc = &lc_shm->comms[c->id];
+    lc_slot *slot = &sc->reduce[op & 1][c->rank];
+    lc_wait_eq(&slot->readers, 0);
+    uint64_t off = sc->data_off + (2 + (op & 1) * c->size + c->rank) * lc_shm->max_msg;
+    memcpy(lc_payload(off), send, bytes);
+    slot->bytes = bytes;
+    __atomic_store_n(&slot->readers, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->seq, op / 2 + 1, __ATOMIC_RELEASE);
+    lc_futex_wake(&slot->seq);
+}
+
+static inline void lc_wait(lc_request *r) {
+    if (r->kind == LC_REQ_DONE) return;
+    lc_comm *c = r->comm;
+    lc_shared_comm *sc = &lc_shm->comms[c->id];
+    uint32_t op = r->op;
+    if (r->kind == LC_REQ_BCAST_RECV) {
+        lc_slot *slot = &sc->bcast[op & 1];
+        lc_wait_eq(&slot->seq, op / 2 + 1);
+        memcpy(r->buf, lc_payload(sc->data_off + (op & 1) * lc_shm->max_msg), r->bytes);
+        if (__atomic_sub_fetch(&slot->readers, 1, __ATOMIC_ACQ_REL) == 0)
+            lc_futex_wake(&slot->readers);
+    } else {
+        double *acc = (double *)r->buf;
+        size_t n = r->bytes / sizeof(double);
+        for (int m = 0; m < c->size; m++) {
+            if (m == c->rank) continue;
+            lc_slot *slot = &sc->reduce[op & 1][m];
+            lc_wait_eq(&slot->seq, op / 2 + 1);
+            uint64_t off = sc->data_off + (2 + (op & 1) * c->size + m) * lc_shm->max_msg;
+            const double *src = (const double *)lc_payload(off);
+            for (size_t i = 0; i < n; i++) acc[i] += src[i];
+            __atomic_store_n(&slot->readers, 0, __ATOMIC_RELEASE);
+            lc_futex_wake(&slot->readers);
+        }
+    }
+    r->kind = LC_REQ_DONE;
+}
+
+/* Rank 0 returns the job's exit status (non-zero if any rank failed);
+ * every other rank exits here. */
+static inline int lc_finalize(void) {
+    lc_barrier(&lc_world_comm);
+    if (lc_world_rank != 0) {
+        fflush(stdout);
+        _exit(0);
+    }
+    int status = 0;
+    for (int r = 1; r < lc_world_comm.size; r++) {
+        int st = 0;
+        if (waitpid(lc_children[r], &st, 0) < 0 || !WIFEXITED(st) || WEXITSTATUS(st) != 0)
+            status = 1;
+    }
+    munmap(lc_shm, lc_shm_bytes);
+    lc_shm = NULL;
+    return status;
+}
+
+#endif /* HPC_USE_MPI */
+
+/* Blocking conveniences shared by both backends */
+static inline void lc_bcast(void *buf, size_t bytes, int root, lc_comm *c) {
+    lc_request r;
+    lc_ibcast(buf, bytes, root, c, &r);
+    lc_wait(&r);
+}
+
+static inline void lc_reduce_sum(const double *send, double *recv, size_t n, int root, lc_comm *c) {
+    lc_request r;
+    lc_ireduce_sum(send, recv, n, root, c, &r);
+    lc_wait(&r);
+}
+
+static inline int lc_rank(const lc_comm *c) { return c->rank; }
+static inline int lc_size(const lc_comm *c) { return c->size; }
+
+#endif
@@ -0,0 +1,106 @@
+/*
+ * loop_nest.hpp - compile-time GEMM loop-nest generator
+ *
+ * LoopNest<D0, D1, D2, TI, TJ, TK, U> is C += A * B written as three loops
+ * in the order D0, D1, D2 (each one of NEST_I, NEST_J, NEST_K), so all six
+ * orders IJK, IKJ, JIK, JKI, KIJ, KJI come from one template:
+ *   - T* > 0 tiles that dimension: tile loops run in the same order as the
+ *     point loops, and a 0 leaves the dimension untiled
+ *   - U unrolls the innermost loop: U independent partial sums when K is
+ *     innermost, U elements of the C column when I is; a J-innermost row
+ *     update is unit-stride and left to the compiler's vectorizer
+ * The innermost body is picked at compile time from D2: a dot product
+ * (K), a row AXPY (J) or a column AXPY (I).
+ *
+ * Matrices are anything indexable as M[r][c] with contiguous rows
+ * (vector<vector<double>>, double**, ...). run() covers the sub-box
+ * lo..hi of the (i, j, k) iteration space; callers hand every thread a
+ * disjoint range of i or j (split_dim() says which), so no two threads
+ * write the same element of C even for K-outer orders.
+ */
+#ifndef HPC_LOOP_NEST_HPP
+#define HPC_LOOP_NEST_HPP
+
+#include <string>
+
+enum { NEST_I = 0, NEST_J = 1, NEST_K = 2 };
+
+template <int D0, int D1, int D2, int TI, int TJ, int TK, int U>
+struct LoopNest {
+    static_assert(D0 != D1 && D1 != D2 && D0 != D2 && D0 >= 0 && D0 < 3 &&
+                  D1 >= 0 && D1 < 3 && D2 >= 0 && D2 < 3, "loop order must permute I, J, K");
+    static_assert(U >= 1 && U <= 16, "unroll factor out of range");
+
+    // Dimension to split across threads: the outermost of I and J
+    static constexpr int split_dim() { return D0 != NEST_K ? D0 : D1; }
+
+    static std::string name() {
+        const char dims[] = "IJK";
+        std::string s{dims[D0], dims[D1], dims[D2]};
+        if (TI || TJ || TK) {
+            s += "-t";
+            if (TI == TJ && TJ == TK) s += std::to_string(TI);
+            else s += std::to_string(TI) + "x" + std::to_string(TJ) + "x" + std::to_string(TK);
+        }
+        if (U > 1 && D2 != NEST_J) s += "u" + std::to_string(U);
+        return s;
+    }
+
+    template <class Mat>
+    static void run(const Mat& A, const Mat& B, Mat& C, const int lo[3], const int hi[3]) {
+        const int tile[3] = {TI, TJ, TK};
+        int step[3], b[3], e[3];
+        for (int d = 0; d < 3; d++) step[d] = tile[d] > 0 ? tile[d] : (hi[d] - lo[d] > 0 ? hi[d] - lo[d] : 1);
+        for (b[D0] = lo[D0]; b[D0] < hi[D0]; b[D0] += step[D0]) {
+            e[D0] = b[D0] + step[D0] < hi[D0] ? b[D0] + step[D0] : hi[D0];
+            for (b[D1] = lo[D1]; b[D1] < hi[D1]; b[D1] += step[D1]) {
+                e[D1] = b[D1] + step[D1] < hi[D1] ? b[D1] + step[D1] : hi[D1];
+                for (b[D2] = lo[D2]; b[D2] < hi[D2]; b[D2] += step[D2]) {
+                    e[D2] = b[D2] + step[D2] < hi[D2] ? b[D2] + step[D2] : hi[D2];
+                    points(A, B, C, b, e);
+                }
+            }
+        }
+    }
+
+private:
+    template <class Mat>
+    static void points(const Mat& A, const Mat& B, Mat& C, const int b[3], const int e[3]) {
+        int x[3];
+        for (x[D0] = b[D0]; x[D0] < e[D0]; x[D0]++)
+            for (x[D1] = b[D1]; x[D1] < e[D1]; x[D1]++)
+                inner(A, B, C, x[NEST_I], x[NEST_J], x[NEST_K], b[D2], e[D2]);
+    }
+
+    // Innermost loop over D2 from lo to hi; the other two indices are fixed
+    // (the one named by D2 is ignored)
+    template <class Mat>
+    static inline void inner(const Mat& A, const Mat& B, Mat& C, int i, int j, int k, int lo, int hi) {
+        if constexpr (D2 == NEST_K) {
+            const auto& arow = A[i];
+            double part[U] = {};
+            int kk = lo;
+            for (; kk + U <= hi; kk += U)
+                for (int u = 0; u < U; u++) part[u] += arow[kk + u] * B[kk + u][j];
+            double sum = 0.0;
+            for (int u = 0; u < U; u++) sum += part[u];
+            for (; kk < hi; kk++) sum += arow[kk] * B[kk][j];
+            C[i][j] += sum;
+        } else if constexpr (D2 == NEST_J) {
+            // contiguous and unit-stride: the vectorizer unrolls this better
+            // than a manual U-way split, so U does not apply here
+            const double r = A[i][k];
+            const double* __restrict brow = &B[k][0];
+            double* __restrict crow = &C[i][0];
+            for (int jj = lo; jj < hi; jj++) crow[jj] += r * brow[jj];
+        } else {
+            const double r = B[k][j];
+            int ii = lo;
+            for (; ii + U <= hi; ii += U)
+                for (int u = 0; u < U; u++) C[ii + u][j] += A[ii + u][k] * r;
+            for (; ii < hi; ii++) C[ii][j] += A[ii][k] * r;
+        }
+    }
+};
+
+#endif
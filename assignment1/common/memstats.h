@@ -0,0 +1,120 @@
+/*
+ * memstats.h - page-fault accounting around timed regions
+ *
+ * A first touch of a fresh page inside a timed loop costs a kernel entry,
+ * a page clear and a TLB fill, and on a 256x256 run a handful of those is
+ * already a visible fraction of the runtime. Bracket every timed region
+ * with hpc_faults_begin / hpc_faults_end: the counts come from
+ * getrusage(RUSAGE_SELF), so they cover every thread of the process,
+ * including threads spawned and joined inside the region.
+ *
+ * A region is flagged as contaminated when it saw any major fault, or more
+ * minor faults than HPC_FAULT_LIMIT (default 4; thread creation may touch
+ * a stack page or two even when glibc reuses cached stacks).
+ *
+ * hpc_mem_begin / hpc_mem_end measure the memory side of the same region:
+ *   alloc_bytes      arena bytes requested inside the region (scratch,
+ *                    temporaries, packing buffers)
+ *   footprint_bytes  arena bytes reserved by live blocks, including block
+ *                    headers and size-class rounding, i.e. what a job has
+ *                    to be sized for (larger of the values at begin and end)
+ *   rss_peak_kb      growth of the peak RSS over the region. The peak is
+ *                    reset with /proc/self/clear_refs first; where that is
+ *                    not permitted only growth of the process-lifetime peak
+ *                    is seen.
+ * Call hpc_mem_begin before the timer starts: resetting the peak costs a
+ * syscall and a /proc read.
+ *
+ * Header-only, usable from both C and C++.
+ */
+#ifndef HPC_MEMSTATS_H
+#define HPC_MEMSTATS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/resource.h>
+
+#include "arena.h"
+
+typedef struct {
+    long minflt;
+    long majflt;
+} hpc_faults_t;
+
+static inline void hpc_faults_begin(hpc_faults_t *f) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    f->minflt = ru.ru_minflt;
+    f->majflt = ru.ru_majflt;
+}
+
+/* Turns the snapshot taken by hpc_faults_begin into the delta since then */
+static inline void hpc_faults_end(hpc_faults_t *f) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    f->minflt = ru.ru_minflt - f->minflt;
+    f->majflt = ru.ru_majflt - f->majflt;
+}
+
+static inline long hpc_fault_limit(void) {
+    static long limit = -1;
+    if (limit < 0) {
+        const char *env = getenv("HPC_FAULT_LIMIT");
+        limit = env ? atol(env) : 4;
+        if (limit < 0) limit = 0;
+    }
+    return limit;
+}
+
+static inline int hpc_faults_contaminated(const hpc_faults_t *f) {
+    return f->majflt > 0 || f->minflt > hpc_fault_limit();
+}
+
+typedef struct {
+    uint64_t alloc_bytes;
+    uint64_t footprint_bytes;
+    long rss_peak_kb;
+    long rss0_kb;             /* baseline, internal */
+} hpc_mem_t;
+
+/* VmRSS / VmHWM from /proc/self/status in KB, -1 if unavailable */
+static inline long hpc_proc_status_kb(const char *key) {
+    FILE *f = fopen("/proc/self/status", "r");
+    if (!f) return -1;
+    char line[256];
+    long kb = -1;
+    size_t len = strlen(key);
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, key, len) == 0 && line[len] == ':') {
+            kb = atol(line + len + 1);
+            break;
+        }
+    }
+    fclose(f);
+    return kb;
+}
+
+static inline void hpc_mem_begin(hpc_mem_t *m) {
+    hpc_arena_stats_t s;
+    hpc_arena_stats(&s);
+    m->alloc_bytes = s.bytes_requested;
+    m->footprint_bytes = s.bytes_reserved;
+    FILE *f = fopen("/proc/self/clear_refs", "w");
+    int reset = f && fputs("5", f) >= 0;
+    if (f && fclose(f) != 0) reset = 0;
+    /* after a reset VmHWM restarts from the current RSS */
+    m->rss0_kb = hpc_proc_status_kb(reset ? "VmRSS" : "VmHWM");
+}
+
+static inline void hpc_mem_end(hpc_mem_t *m) {
+    hpc_arena_stats_t s;
+    hpc_arena_stats(&s);
+    m->alloc_bytes = s.bytes_requested - m->alloc_bytes;
+    if (s.bytes_reserved > m->footprint_bytes) m->footprint_bytes = s.bytes_reserved;
+    long hwm = hpc_proc_status_kb("VmHWM");
+    m->rss_peak_kb = (hwm >= 0 && m->rss0_kb >= 0 && hwm > m->rss0_kb) ? hwm - m->rss0_kb : 0;
+}
+
+#endif
@@ -0,0 +1,131 @@
+/*
+ * mpmc_queue.hpp - bounded multi-producer multi-consumer queues for tile tasks
+ *
+ * MpmcQueue is Dmitry Vyukov's bounded array queue: every cell carries a
+ * sequence number that tells producers whether it is free for lap L and
+ * consumers whether it holds the item of lap L, so a push or pop is one CAS
+ * on the shared position plus one release store on the cell. No locks and
+ * no per-item allocation.
+ *
+ * MutexQueue has the same interface over a ring buffer and a std::mutex and
+ * exists as the baseline for the benchmarks.
+ */
+#ifndef HPC_MPMC_QUEUE_HPP
+#define HPC_MPMC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+template <typename T>
+class MpmcQueue {
+public:
+    // capacity is rounded up to a power of two
+    explicit MpmcQueue(size_t capacity)
+        : cells_(new Cell[round_pow2(capacity)]), mask_(round_pow2(capacity) - 1) {
+        size_t cap = mask_ + 1;
+        for (size_t i = 0; i < cap; i++) cells_[i].seq.store(i, std::memory_order_relaxed);
+        enqueue_pos_.store(0, std::memory_order_relaxed);
+        dequeue_pos_.store(0, std::memory_order_relaxed);
+    }
+
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    bool try_push(const T& item) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & mask_];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                // cell free for this lap: claim the position
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.data = item;
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;   // full: consumer of the previous lap not done
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool try_pop(T& item) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & mask_];
+            size_t seq = cell.seq.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    item = cell.data;
+                    // free the cell for the producer one lap ahead
+                    cell.seq.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;   // empty
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<size_t> seq;
+        T data;
+    };
+
+    static size_t round_pow2(size_t v) {
+        size_t cap = 2;
+        while (cap < v) cap <<= 1;
+        return cap;
+    }
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> enqueue_pos_;
+    alignas(64) std::atomic<size_t> dequeue_pos_;
+};
+
+template <typename T>
+class MutexQueue {
+public:
+    explicit MutexQueue(size_t capacity) : buf_(capacity ? capacity : 1) {}
+
+    bool try_push(const T& item) {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (count_ == buf_.size()) return false;
+        buf_[(head_ + count_) % buf_.size()] = item;
+        count_++;
+        return true;
+    }
+
+    bool try_pop(T& item) {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (count_ == 0) return false;
+        item = buf_[head_];
+        head_ = (head_ + 1) % buf_.size();
+        count_--;
+        return true;
+    }
+
+    size_t capacity() const { return buf_.size(); }
+
+private:
+    std::mutex mu_;
+    std::vector<T> buf_;
+    size_t head_ = 0;
+    size_t count_ = 0;
+};
+
+#endif
@@ -0,0 +1,75 @@
+/*
+ * partition.h - balanced, alignment-aware work ranges for element-wise kernels
+ *
+ * hpc_split(n, tid, T) gives thread tid a contiguous [begin, end) of n items
+ * (rows, columns, elements). Sizes differ by at most one item, so the
+ * remainder is spread over the first n % T threads rather than piled onto
+ * the last one.
+ *
+ * hpc_split_aligned(n, elem, base, align, tid, T) does the same for n
+ * elements of elem bytes starting at base, but places every boundary on an
+ * align-byte boundary of the address space: no two threads write the same
+ * cache line (align 64), or the same page when pages are placed by first
+ * touch on a NUMA machine (4096, or 2 MB for huge pages). Granules are
+ * balanced the same way, so sizes differ by at most one granule; with
+ * coarse alignment and a small array some threads get an empty range.
+ * The first granule is short when base itself is not aligned.
+ *
+ * hpc_partition_align() is the alignment the kernels use: 64 by default,
+ * HPC_PART_ALIGN=page or =huge (or a byte count) for page granularity.
+ *
+ * Header-only, usable from both C and C++.
+ */
+#ifndef HPC_PARTITION_H
+#define HPC_PARTITION_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+typedef struct {
+    size_t begin;
+    size_t end;
+} hpc_range_t;
+
+static inline hpc_range_t hpc_split(size_t n, int tid, int nthreads) {
+    hpc_range_t r;
+    size_t q = n / (size_t)nthreads, rem = n % (size_t)nthreads, t = (size_t)tid;
+    r.begin = t * q + (t < rem ? t : rem);
+    r.end = r.begin + q + (t < rem ? 1 : 0);
+    return r;
+}
+
+static inline hpc_range_t hpc_split_aligned(size_t n, size_t elem, const void *base, size_t align,
+                                            int tid, int nthreads) {
+    if (align < elem || align % elem) return hpc_split(n, tid, nthreads);
+    size_t per = align / elem;                     /* elements per granule */
+    size_t mis = (uintptr_t)base % align;
+    size_t head = mis ? (align - mis) / elem : 0;  /* elements before the first boundary */
+    if (head > n) head = n;
+    /* a short head (if base is misaligned) is granule 0, then full granules */
+    size_t lead = head ? 1 : 0;
+    size_t granules = lead + (n - head + per - 1) / per;
+    hpc_range_t g = hpc_split(granules, tid, nthreads);
+    hpc_range_t r;
+    r.begin = g.begin < lead ? 0 : head + (g.begin - lead) * per;
+    r.end = g.end < lead ? 0 : head + (g.end - lead) * per;
+    if (r.begin > n) r.begin = n;
+    if (r.end > n) r.end = n;
+    return r;
+}
+
+static inline size_t hpc_partition_align(void) {
+    static size_t align = 0;
+    if (!align) {
+        const char *env = getenv("HPC_PART_ALIGN");
+        if (!env) align = 64;
+        else if (strcmp(env, "page") == 0) align = 4096;
+        else if (strcmp(env, "huge") == 0) align = (size_t)2 << 20;
+        else align = (size_t)atol(env);
+        if (align < 64 || (align & (align - 1))) align = 64;
+    }
+    return align;
+}
+
+#endif
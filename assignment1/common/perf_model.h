@@ -0,0 +1,386 @@
+/*
+ * perf_model.h - predicted kernel time from traffic per cache level
+ *
+ * cost_model.h knows what one more thread costs; this predicts what a
+ * given access pattern costs, for shapes never run. A kernel is described
+ * as a loop nest over N (order of the loop variables i, j, k) and the
+ * arrays it touches, each with a row and a contiguous index. For every
+ * cache level the model counts the bytes that miss it, with the usual
+ * reuse rule applied from the innermost loop outwards:
+ *
+ *   everything an array touches inside loop l fits in the level
+ *                              -> each of those lines is loaded once
+ *   else, loop l walks the array's contiguous index and one iteration
+ *   fits                       -> 8 iterations share every line
+ *   else                       -> the inner traffic repeats per iteration
+ *
+ * An array may take its share of a level (1 / number of arrays), written
+ * arrays count twice (write-allocate plus write-back). A tiled GEMM whose
+ * three tiles fit a level moves 32 N^3 / tile bytes past it; with larger
+ * tiles the nest inside one tile is counted and repeated per tile. Calls
+ * are timed warm (after warmup runs or repeats), so a level that holds a
+ * thread's whole footprint misses nothing. Threads split the outermost
+ * loop: L1/L2 are private, so every thread sees the full capacity and its
+ * own bandwidth; L3 capacity is shared; DRAM bandwidth grows with threads
+ * up to the all-core bandwidth measured here.
+ *
+ * The prediction is a roofline over the hierarchy,
+ *   time = max(compute, loads / L1 bw, misses(L1) / L2 bw,
+ *              misses(L2) / L3 bw, misses(L3) / DRAM bw) + overhead
+ * with the single-thread bandwidths from cache_probe.h. compute is
+ * flops * flop_ns (cost_model.h), divided by the SIMD width when every
+ * array the inner loop walks is unit-stride, and at least one dependent
+ * add per iteration and accumulator when the inner loop reduces into one
+ * element (no -ffast-math, so the compiler keeps the chain). measured /
+ * predicted far from 1 means the kernel does something the model does
+ * not: conflict misses or a loop left scalar (slower), prefetching or
+ * unrolled chains (faster).
+ *
+ * The all-core DRAM bandwidth is measured once and cached in
+ * /tmp/hpc_perf_model.<hostname> (HPC_PERF_MODEL_FILE overrides,
+ * HPC_RECALIBRATE=1 measures again). The reduction latency depends on the
+ * build's flags, so it is measured per process (~15 ms).
+ *
+ * Header-only, usable from both C and C++.
+ */
+#ifndef HPC_PERF_MODEL_H
+#define HPC_PERF_MODEL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "cost_model.h"
+
+enum { HPC_PM_I = 0, HPC_PM_J = 1, HPC_PM_K = 2, HPC_PM_NONE = -1 };
+
+typedef struct {
+    int row, col;           /* loop variables indexing it; row -1 for vectors */
+    double weight;          /* 1 read, 2 written */
+} hpc_pm_array_t;
+
+typedef struct {
+    int depth;              /* 2 (add, GEMV) or 3 (GEMM) */
+    int order[3];           /* loop variables, outermost first */
+    int narr;
+    hpc_pm_array_t arr[3];
+    double flops_per_iter;  /* per innermost iteration */
+    int tile;               /* GEMM tile edge, 0 = untiled */
+    int chains;             /* independent accumulators of a reduction */
+} hpc_pm_shape_t;
+
+typedef struct {
+    const hpc_cost_model_t *cm;
+    double dram_all_gbs;    /* all cores streaming together */
+    double add_ns;          /* latency of one step of sum += a * b */
+} hpc_perf_model_t;
+
+typedef struct {
+    double bytes[4];        /* per thread: L1 loads, misses of L1, L2, L3 */
+    double level_ns[4];
+    double compute_ns;
+    double overhead_ns;
+    double total_ns;
+    int bound;              /* 0..3 the level that dominates, 4 compute */
+} hpc_pm_prediction_t;
+
+static const char *const hpc_pm_bound_names[5] = {"L1", "L2", "L3", "DRAM", "compute"};
+
+/* ---- shapes of the repo's kernels ---- */
+
+/* b/: C = A + B; pattern 1 walks columns, every other one rows */
+static inline hpc_pm_shape_t hpc_pm_shape_add(int pattern) {
+    hpc_pm_shape_t s;
+    memset(&s, 0, sizeof(s));
+    s.depth = 2;
+    s.order[0] = pattern == 1 ? HPC_PM_J : HPC_PM_I;
+    s.order[1] = pattern == 1 ? HPC_PM_I : HPC_PM_J;
+    s.narr = 3;
+    s.arr[0] = (hpc_pm_array_t){HPC_PM_I, HPC_PM_J, 1.0};
+    s.arr[1] = (hpc_pm_array_t){HPC_PM_I, HPC_PM_J, 1.0};
+    s.arr[2] = (hpc_pm_array_t){HPC_PM_I, HPC_PM_J, 2.0};
+    s.flops_per_iter = 1.0;
+    s.chains = 1;
+    return s;
+}
+
+/* c/: y = A x; patterns 1 and 3 walk columns of A, the rest rows; 6 and 7
+ * keep eight row sums in registers */
+static inline hpc_pm_shape_t hpc_pm_shape_gemv(int pattern) {
+    hpc_pm_shape_t s;
+    memset(&s, 0, sizeof(s));
+    int col = pattern == 1 || pattern == 3;
+    s.depth = 2;
+    s.order[0] = col ? HPC_PM_J : HPC_PM_I;
+    s.order[1] = col ? HPC_PM_I : HPC_PM_J;
+    s.narr = 3;
+    s.arr[0] = (hpc_pm_array_t){HPC_PM_I, HPC_PM_J, 1.0};       /* A */
+    s.arr[1] = (hpc_pm_array_t){HPC_PM_NONE, HPC_PM_J, 1.0};    /* x */
+    s.arr[2] = (hpc_pm_array_t){HPC_PM_NONE, HPC_PM_I, 2.0};    /* y */
+    s.flops_per_iter = 2.0;
+    s.chains = pattern >= 6 ? 8 : 1;
+    return s;
+}
+
+/* d/: C = A B with the loop order as three letters ("ikj", "KJI", ...) */
+static inline hpc_pm_shape_t hpc_pm_shape_gemm(const char *order, int tile) {
+    hpc_pm_shape_t s;
+    memset(&s, 0, sizeof(s));
+    s.depth = 3;
+    for (int l = 0; l < 3; l++) {
+        char c = order && order[l] ? (char)tolower((unsigned char)order[l]) : "ijk"[l];
+        s.order[l] = c == 'i' ? HPC_PM_I : c == 'j' ? HPC_PM_J : HPC_PM_K;
+    }
+    s.narr = 3;
+    s.arr[0] = (hpc_pm_array_t){HPC_PM_I, HPC_PM_K, 1.0};       /* A */
+    s.arr[1] = (hpc_pm_array_t){HPC_PM_K, HPC_PM_J, 1.0};       /* B */
+    s.arr[2] = (hpc_pm_array_t){HPC_PM_I, HPC_PM_J, 2.0};       /* C */
+    s.flops_per_iter = 2.0;
+    s.tile = tile;
+    s.chains = 1;
+    return s;
+}
+
+/* ---- traffic ---- */
+
+/* Lines an array touches while loops l..depth-1 run once */
+static inline double hpc_pm_lines(const hpc_pm_shape_t *s, const hpc_pm_array_t *a, const double *ext,
+                                  int l, double line_elems) {
+    double lines = 1.0;
+    for (int m = l; m < s->depth; m++) {
+        if (s->order[m] == a->col) lines *= ceil(ext[m] / line_elems);
+        else if (s->order[m] == a->row) lines *= ext[m];
+    }
+    return lines;
+}
+
+/* Bytes of one array missing a level of `cap` bytes while loops l.. run */
+static inline double hpc_pm_array_traffic(const hpc_pm_shape_t *s, const hpc_pm_array_t *a, const double *ext,
+                                          int l, double cap, double line) {
+    double le = line / sizeof(double);
+    if (l >= s->depth || l >= 3) return line;
+    double fp = hpc_pm_lines(s, a, ext, l, le) * line;
+    if (fp <= cap) return fp;
+    double inner = hpc_pm_array_traffic(s, a, ext, l + 1, cap, line);
+    if (s->order[l] == a->col && hpc_pm_lines(s, a, ext, l + 1, le) * line <= cap)
+        return ceil(ext[l] / le) * inner;
+    return ext[l] * inner;
+}
+
+/* Bytes per thread missing a level of `cap` bytes */
+static inline double hpc_pm_traffic(const hpc_pm_shape_t *s, double n, int threads, double cap, double line) {
+    double ext[3] = {ceil(n / threads), n, n};
+    double products = 1.0;      /* tile products per thread; 1 untiled */
+    if (s->tile > 0 && s->tile < n && 3.0 * n * n * sizeof(double) > cap) {
+        double b = s->tile, nt = ceil(n / b);
+        /* three tiles fit: every tile product moves A and B tiles in and C in and out */
+        if (3.0 * b * b * sizeof(double) <= cap) return 32.0 * n * n * n / b / threads;
+        products = ceil(nt / threads) * nt * nt;
+        ext[0] = ext[1] = ext[2] = b;
+    }
+    /* timed calls run warm: a footprint that fits stays resident */
+    double fp = 0.0;
+    for (int a = 0; a < s->narr; a++) fp += hpc_pm_lines(s, &s->arr[a], ext, 0, line / sizeof(double)) * line;
+    if (products == 1.0 && fp <= cap) return 0.0;
+    double total = 0.0;
+    for (int a = 0; a < s->narr; a++)
+        total += s->arr[a].weight * hpc_pm_array_traffic(s, &s->arr[a], ext, 0, cap / s->narr, line);
+    return products * total;
+}
+
+/* Element loads per thread (operands invariant in the inner loop stay in registers) */
+static inline double hpc_pm_loads(const hpc_pm_shape_t *s, double n, int threads) {
+    double iters = ceil(n / threads);
+    for (int l = 1; l < s->depth; l++) iters *= n;
+    int inner = s->order[s->depth - 1];
+    double loads = 0.0;
+    for (int a = 0; a < s->narr; a++)
+        loads += (s->arr[a].row == inner || s->arr[a].col == inner) ? iters : iters / n;
+    return loads;
+}
+
+/* Doubles per vector register the compiler targets */
+#if defined(__AVX512F__)
+#define HPC_PM_SIMD 8
+#elif defined(__AVX__)
+#define HPC_PM_SIMD 4
+#else
+#define HPC_PM_SIMD 2
+#endif
+
+/* The inner loop writes one element throughout: a serial chain of adds */
+static inline int hpc_pm_reduction(const hpc_pm_shape_t *s) {
+    int inner = s->order[s->depth - 1];
+    for (int a = 0; a < s->narr; a++)
+        if (s->arr[a].weight > 1.0 && s->arr[a].row != inner && s->arr[a].col != inner) return 1;
+    return 0;
+}
+
+/* Every array the inner loop walks is contiguous in it: vectorizable,
+ * unless it is a single-accumulator reduction */
+static inline int hpc_pm_unit_stride(const hpc_pm_shape_t *s) {
+    int inner = s->order[s->depth - 1];
+    for (int a = 0; a < s->narr; a++)
+        if (s->arr[a].row == inner) return 0;
+    return s->chains > 1 || !hpc_pm_reduction(s);
+}
+
+/* ---- calibration ---- */
+
+typedef struct {
+    size_t bytes;
+    double gbs;
+} hpc_pm_bw_arg;
+
+static inline void *hpc_pm_bw_worker(void *v) {
+    hpc_pm_bw_arg *a = (hpc_pm_bw_arg *)v;
+    a->gbs = cp_read_bw(a->bytes);
+    return NULL;
+}
+
+/* One dependent chain of sum += a * b, built the way the kernels' is (an
+ * FMA where the flags contract it): what a reduction waits for per element */
+static inline double hpc_pm_add_ns(void) {
+    const long n = 1 << 22;
+    volatile double one = 1.0, half = 0.5;
+    double y = one, z = half, best = 1e30;
+    for (int r = 0; r < 3; r++) {
+        double x = 0.0, t0 = cp_now_ns();
+        for (long i = 0; i < n; i++) x += y * z;
+        double dt = cp_now_ns() - t0;
+        volatile double sink = x;
+        (void)sink;
+        if (dt < best) best = dt;
+    }
+    return best / n;
+}
+
+/* Sum of concurrent streaming reads, one per core, over 4x the LLC in total */
+static inline double hpc_pm_dram_all_gbs(const hpc_cost_model_t *cm) {
+    int t = cm->cores < 64 ? cm->cores : 64;
+    size_t llc = cm->cache.l3_bytes ? cm->cache.l3_bytes : cm->cache.l2_bytes;
+    size_t total = llc ? 4 * llc : (size_t)256 << 20;
+    if (total > ((size_t)512 << 20)) total = (size_t)512 << 20;
+    pthread_t th[64];
+    hpc_pm_bw_arg arg[64];
+    for (int i = 0; i < t; i++) {
+        arg[i].bytes = total / t;
+        arg[i].gbs = 0.0;
+        pthread_create(&th[i], NULL, hpc_pm_bw_worker, &arg[i]);
+    }
+    double sum = 0.0;
+    for (int i = 0; i < t; i++) {
+        pthread_join(th[i], NULL);
+        sum += arg[i].gbs;
+    }
+    return sum;
+}
+
+static inline void hpc_pm_path(char *path, size_t len) {
+    const char *env = getenv("HPC_PERF_MODEL_FILE");
+    if (env && *env) { snprintf(path, len, "%s", env); return; }
+    char host[64] = "localhost";
+    gethostname(host, sizeof(host) - 1);
+    snprintf(path, len, "/tmp/hpc_perf_model.%s", host);
+}
+
+/* Host model: cost model plus all-core DRAM bandwidth. Computed once per process. */
+static inline const hpc_perf_model_t *hpc_perf_model(void) {
+    static hpc_perf_model_t m;
+    static int ready = 0;
+    if (ready) return &m;
+    m.cm = hpc_cost_model();
+    m.dram_all_gbs = 0.0;
+    char path[256];
+    hpc_pm_path(path, sizeof(path));
+    const char *re = getenv("HPC_RECALIBRATE");
+    FILE *f = (re && strcmp(re, "1") == 0) ? NULL : fopen(path, "r");
+    if (f) {
+        if (fscanf(f, "dram_all_gbs=%lf", &m.dram_all_gbs) != 1) m.dram_all_gbs = 0.0;
+        fclose(f);
+    }
+    if (m.dram_all_gbs <= 0.0) {
+        m.dram_all_gbs = hpc_pm_dram_all_gbs(m.cm);
+        f = fopen(path, "w");
+        if (f) {
+            fprintf(f, "dram_all_gbs=%.3f\n", m.dram_all_gbs);
+            fclose(f);
+        }
+    }
+    m.add_ns = hpc_pm_add_ns();
+    ready = 1;
+    return &m;
+}
+
+/* ---- prediction ---- */
+
+/* Time of one call at size n on `threads` threads; per_thread_ns is the
+ * dispatch cost of each extra thread, as for hpc_auto_threads */
+static inline hpc_pm_prediction_t hpc_pm_predict(const hpc_perf_model_t *m, const hpc_pm_shape_t *s,
+                                                 int n, int threads, double per_thread_ns) {
+    hpc_pm_prediction_t p;
+    memset(&p, 0, sizeof(p));
+    const cache_info_t *c = &m->cm->cache;
+    if (threads < 1) threads = 1;
+    int run = threads < m->cm->cores ? threads : m->cm->cores;   /* threads running at once */
+    double line = c->line_size ? (double)c->line_size : 64.0;
+    double dn = n;
+
+    double bw[4];
+    for (int l = 0; l < 4; l++) bw[l] = c->bw_gbs[l] > 0.0 ? c->bw_gbs[l] : 10.0;
+    if (c->bw_gbs[2] <= 0.0) bw[2] = bw[3];
+    double dram = bw[3] * run;
+    if (m->dram_all_gbs > 0.0 && dram > m->dram_all_gbs) dram = m->dram_all_gbs;
+    /* per-thread share of the shared levels' bandwidth */
+    double bw_thread[4] = {bw[0], bw[1], bw[2], dram / run};
+
+    p.bytes[0] = hpc_pm_loads(s, dn, threads) * sizeof(double);
+    p.bytes[1] = hpc_pm_traffic(s, dn, threads, (double)c->l1_bytes, line);
+    p.bytes[2] = hpc_pm_traffic(s, dn, threads, (double)c->l2_bytes, line);
+    p.bytes[3] = c->l3_bytes ? hpc_pm_traffic(s, dn, threads, (double)c->l3_bytes / run, line) : p.bytes[2];
+
+    /* threads beyond the cores queue: each core runs threads / cores shares */
+    double waves = (double)threads / run;
+    double iters = ceil(dn / threads);
+    for (int l = 1; l < s->depth; l++) iters *= dn;
+    double iter_ns = s->flops_per_iter * m->cm->flop_ns;
+    if (hpc_pm_unit_stride(s)) iter_ns /= HPC_PM_SIMD;
+    if (hpc_pm_reduction(s) && iter_ns < m->add_ns / s->chains) iter_ns = m->add_ns / s->chains;
+    p.compute_ns = iters * iter_ns * waves;
+    double worst = p.compute_ns;
+    p.bound = 4;
+    for (int l = 0; l < 4; l++) {
+        p.level_ns[l] = p.bytes[l] / bw_thread[l] * waves;
+        if (p.level_ns[l] > worst) { worst = p.level_ns[l]; p.bound = l; }
+    }
+    p.overhead_ns = per_thread_ns * (threads - 1);
+    p.total_ns = worst + p.overhead_ns;
+    return p;
+}
+
+static inline double hpc_pm_predict_ns(const hpc_pm_shape_t *s, int n, int threads, double per_thread_ns) {
+    return hpc_pm_predict(hpc_perf_model(), s, n, threads, per_thread_ns).total_ns;
+}
+
+/* Thread count (1..max_threads) with the smallest predicted time: the
+ * pattern-aware counterpart of hpc_auto_threads */
+static inline int hpc_pm_best_threads(const hpc_pm_shape_t *s, int n, int max_threads, double per_thread_ns) {
+    int best_t = 1;
+    double best = hpc_pm_predict_ns(s, n, 1, per_thread_ns);
+    for (int t = 2; t <= max_threads; t++) {
+        double pred = hpc_pm_predict_ns(s, n, t, per_thread_ns);
+        if (pred < best) { best = pred; best_t = t; }
+    }
+    return best_t;
+}
+
+/* measured / predicted outside [1/limit, limit] */
+static inline int hpc_pm_deviates(double measured_ns, double predicted_ns, double limit) {
+    double r = measured_ns / predicted_ns;
+    return !(r >= 1.0 / limit && r <= limit);
+}
+
+#endif
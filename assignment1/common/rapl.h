@@ -0,0 +1,126 @@
+/*
+ * rapl.h - package and DRAM energy around timed regions (Linux powercap)
+ *
+ * RAPL energy counters are exposed under /sys/class/powercap/intel-rapl*
+ * (AMD Zen uses the same driver and names): every top-level zone named
+ * package-N is a socket, and a subzone named dram is that socket's memory.
+ * Bracket a timed region with hpc_energy_begin / hpc_energy_end, like
+ * hpc_faults_*: end turns the snapshot into joules per domain, summed over
+ * sockets. Counters wrap at max_energy_range_uj; one wrap per region is
+ * corrected (at tens of watts that is minutes of runtime).
+ *
+ * Availability is the norm to check, not the exception: VMs and containers
+ * often have no powercap, and energy_uj is root-only on kernels since 5.10.
+ * Then valid is 0 and callers print nan. HPC_RAPL=0 turns reading off;
+ * HPC_POWERCAP_DIR points at another powercap tree.
+ * Counters update about every millisecond, so regions much shorter than
+ * that give noisy joules; package energy includes the idle cores.
+ *
+ * Header-only, usable from both C and C++.
+ */
+#ifndef HPC_RAPL_H
+#define HPC_RAPL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <glob.h>
+
+#define HPC_RAPL_MAX 16
+
+typedef struct {
+    int n;
+    int is_dram[HPC_RAPL_MAX];
+    uint64_t range_uj[HPC_RAPL_MAX];
+    char path[HPC_RAPL_MAX][128];     /* energy_uj file */
+} hpc_rapl_domains_t;
+
+typedef struct {
+    uint64_t snap[HPC_RAPL_MAX];
+    double pkg_j;
+    double dram_j;
+    int valid;          /* 0: no readable domain, joules are nan */
+    int has_dram;
+} hpc_energy_t;
+
+static inline int hpc_rapl_read_u64(const char *path, uint64_t *v) {
+    FILE *f = fopen(path, "r");
+    if (!f) return 0;
+    unsigned long long x;
+    int ok = fscanf(f, "%llu", &x) == 1;
+    fclose(f);
+    if (ok) *v = x;
+    return ok;
+}
+
+/* Readable package and dram zones, discovered once per process */
+static inline const hpc_rapl_domains_t *hpc_rapl_domains(void) {
+    static hpc_rapl_domains_t d;
+    static int ready = 0;
+    if (ready) return &d;
+    ready = 1;
+    memset(&d, 0, sizeof(d));
+    const char *off = getenv("HPC_RAPL");
+    if (off && strcmp(off, "0") == 0) return &d;
+
+    const char *root = getenv("HPC_POWERCAP_DIR");
+    char pattern[256];
+    snprintf(pattern, sizeof(pattern), "%s/intel-rapl*:*", root && *root ? root : "/sys/class/powercap");
+    glob_t g;
+    if (glob(pattern, 0, NULL, &g) != 0) return &d;
+    for (size_t i = 0; i < g.gl_pathc && d.n < HPC_RAPL_MAX; i++) {
+        if (strstr(g.gl_pathv[i], "mmio")) continue;   /* same package again, via MMIO */
+        char file[160], name[32] = "";
+        snprintf(file, sizeof(file), "%s/name", g.gl_pathv[i]);
+        FILE *f = fopen(file, "r");
+        if (!f) continue;
+        int got = fscanf(f, "%31s", name);
+        fclose(f);
+        if (got != 1) continue;
+        int dram = strcmp(name, "dram") == 0;
+        if (!dram && strncmp(name, "package", 7) != 0) continue;   /* core/uncore are inside package */
+
+        uint64_t v;
+        snprintf(d.path[d.n], sizeof(d.path[d.n]), "%s/energy_uj", g.gl_pathv[i]);
+        if (!hpc_rapl_read_u64(d.path[d.n], &v)) continue;          /* not permitted */
+        snprintf(file, sizeof(file), "%s/max_energy_range_uj", g.gl_pathv[i]);
+        if (!hpc_rapl_read_u64(file, &d.range_uj[d.n])) d.range_uj[d.n] = 0;
+        d.is_dram[d.n] = dram;
+        d.n++;
+    }
+    globfree(&g);
+    return &d;
+}
+
+static inline void hpc_energy_begin(hpc_energy_t *e) {
+    const hpc_rapl_domains_t *d = hpc_rapl_domains();
+    memset(e, 0, sizeof(*e));
+    for (int i = 0; i < d->n; i++) hpc_rapl_read_u64(d->path[i], &e->snap[i]);
+}
+
+static inline void hpc_energy_end(hpc_energy_t *e) {
+    const hpc_rapl_domains_t *d = hpc_rapl_domains();
+    e->pkg_j = e->dram_j = 0.0;
+    e->valid = d->n > 0;
+    for (int i = 0; i < d->n; i++) {
+        uint64_t now;
+        if (!hpc_rapl_read_u64(d->path[i], &now)) { e->valid = 0; break; }
+        uint64_t delta = now >= e->snap[i] ? now - e->snap[i] : now + d->range_uj[i] - e->snap[i];
+        if (d->is_dram[i]) { e->dram_j += delta * 1e-6; e->has_dram = 1; }
+        else e->pkg_j += delta * 1e-6;
+    }
+    if (!e->valid) e->pkg_j = e->dram_j = NAN;
+    else if (!e->has_dram) e->dram_j = NAN;
+}
+
+/* Package + DRAM joules (DRAM counted only where the platform reports it);
+ * nan when the counters did not tick during the region */
+static inline double hpc_energy_joules(const hpc_energy_t *e) {
+    if (!e->valid) return NAN;
+    double j = e->pkg_j + (e->has_dram ? e->dram_j : 0.0);
+    return j > 0.0 ? j : NAN;
+}
+
+#endif
@@ -0,0 +1,120 @@
+/*
+ * scaling_fit.h - Amdahl and Universal Scalability Law fits of a thread sweep
+ *
+ * Given speedups S(p) measured at thread counts p (with S(1) = 1):
+ *
+ *   Amdahl  S(p) = 1 / (s + (1 - s) / p)
+ *           s is the serial fraction; the ceiling is 1 / s.
+ *   USL     S(p) = p / (1 + sigma (p - 1) + kappa p (p - 1))
+ *           sigma is contention (queueing on a shared resource such as
+ *           memory bandwidth), kappa coherency (pairwise exchange such as
+ *           cache lines moving between cores). With kappa > 0 speedup peaks
+ *           at p* = sqrt((1 - sigma) / kappa) and falls beyond it.
+ *
+ * Both are linear least squares after rearranging
+ *   1/S - 1/p = s (1 - 1/p)
+ *   p/S - 1   = sigma (p - 1) + kappa p (p - 1)
+ * so no iteration and no starting guess. Coefficients are kept physical
+ * (>= 0, s <= 1): a negative one is clamped to 0 and the other refitted
+ * alone. r2 is the coefficient of determination of each model on S.
+ *
+ * Points with p = 1 carry no information but are accepted; with fewer
+ * than two distinct p > 1 the coefficients are nan.
+ *
+ * Header-only, usable from both C and C++.
+ */
+#ifndef HPC_SCALING_FIT_H
+#define HPC_SCALING_FIT_H
+
+#include <math.h>
+
+typedef struct {
+    int n_used;             /* points with p > 1 */
+    double amdahl_s;        /* serial fraction */
+    double amdahl_ceiling;  /* 1 / s; inf for s = 0 */
+    double amdahl_r2;
+    double usl_sigma;       /* contention */
+    double usl_kappa;       /* coherency */
+    double usl_p_opt;       /* thread count of peak speedup; inf if kappa = 0 */
+    double usl_peak;        /* speedup at p_opt (1 / sigma when kappa = 0) */
+    double usl_r2;
+} hpc_scaling_fit_t;
+
+static inline double hpc_amdahl(double s, double p) {
+    return 1.0 / (s + (1.0 - s) / p);
+}
+
+static inline double hpc_usl(double sigma, double kappa, double p) {
+    return p / (1.0 + sigma * (p - 1.0) + kappa * p * (p - 1.0));
+}
+
+/* Coefficient of determination of model speedups against measured ones */
+static inline double hpc_fit_r2(const double *p, const double *s, int n, double a, double b, int usl) {
+    double mean = 0.0;
+    for (int i = 0; i < n; i++) mean += s[i];
+    mean /= n;
+    double ss_res = 0.0, ss_tot = 0.0;
+    for (int i = 0; i < n; i++) {
+        double m = usl ? hpc_usl(a, b, p[i]) : hpc_amdahl(a, p[i]);
+        ss_res += (s[i] - m) * (s[i] - m);
+        ss_tot += (s[i] - mean) * (s[i] - mean);
+    }
+    return ss_tot > 0.0 ? 1.0 - ss_res / ss_tot : NAN;
+}
+
+static inline void hpc_scaling_fit(const double *p, const double *s, int n, hpc_scaling_fit_t *f) {
+    f->n_used = 0;
+    f->amdahl_s = f->amdahl_ceiling = f->amdahl_r2 = NAN;
+    f->usl_sigma = f->usl_kappa = f->usl_p_opt = f->usl_peak = f->usl_r2 = NAN;
+
+    /* normal equations, accumulated over p > 1 */
+    double axx = 0, axy = 0;                        /* Amdahl, one regressor */
+    double x11 = 0, x12 = 0, x22 = 0, y1 = 0, y2 = 0; /* USL, two regressors */
+    double p_first = 0;
+    int distinct = 0;
+    for (int i = 0; i < n; i++) {
+        if (p[i] <= 1.0 || !(s[i] > 0.0)) continue;
+        if (f->n_used == 0) p_first = p[i];
+        if (p[i] != p_first) distinct = 1;
+        f->n_used++;
+        double x = 1.0 - 1.0 / p[i], y = 1.0 / s[i] - 1.0 / p[i];
+        axx += x * x;
+        axy += x * y;
+        double u = p[i] - 1.0, v = p[i] * (p[i] - 1.0), w = p[i] / s[i] - 1.0;
+        x11 += u * u;
+        x12 += u * v;
+        x22 += v * v;
+        y1 += u * w;
+        y2 += v * w;
+    }
+    if (!distinct) return;
+
+    double sf = axy / axx;
+    if (sf < 0.0) sf = 0.0;
+    if (sf > 1.0) sf = 1.0;
+    f->amdahl_s = sf;
+    f->amdahl_ceiling = sf > 0.0 ? 1.0 / sf : INFINITY;
+    f->amdahl_r2 = hpc_fit_r2(p, s, n, sf, 0.0, 0);
+
+    double det = x11 * x22 - x12 * x12;
+    double sigma = det != 0.0 ? (y1 * x22 - y2 * x12) / det : 0.0;
+    double kappa = det != 0.0 ? (y2 * x11 - y1 * x12) / det : 0.0;
+    if (kappa < 0.0) { kappa = 0.0; sigma = y1 / x11; }
+    if (sigma < 0.0) { sigma = 0.0; kappa = y2 / x22; }
+    if (kappa < 0.0) kappa = 0.0;
+    f->usl_sigma = sigma;
+    f->usl_kappa = kappa;
+    if (sigma >= 1.0) {                 /* every added thread slows it down */
+        f->usl_p_opt = 1.0;
+        f->usl_peak = 1.0;
+    } else if (kappa > 0.0) {
+        f->usl_p_opt = sqrt((1.0 - sigma) / kappa);
+        f->usl_peak = hpc_usl(sigma, kappa, f->usl_p_opt);
+    } else {
+        f->usl_p_opt = INFINITY;
+        f->usl_peak = sigma > 0.0 ? 1.0 / sigma : INFINITY;
+    }
+    f->usl_r2 = hpc_fit_r2(p, s, n, sigma, kappa, 1);
+}
+
+#endif
@@ -15,11 +15,23 @@
  * 3. JIK - Column-major traversal for result matrix C
  * 4. JKI - Column-major for both A and C (worst case)
  * 5. Blocked/Tiled - Cache-optimized with blocking
+ *
+ * With --nest, methods generated by common/loop_nest.hpp are added: all six
+ * loop orders (including KIJ and KJI), tiled and untiled, with unrolling.
+ * Build with -DNEST_SWEEP for the full order x tile x unroll sweep.
+ *
+ * With --weak (or --weak=N for a base size other than the smallest), a
+ * weak-scaling phase follows the strong-scaling one: N grows with the
+ * thread count at constant work and at constant memory per thread, and
+ * the results go to weak_scaling.csv.
+ *
+ * Configurations are timed interleaved in random order, with a reference
+ * run between rounds to detect drift (drift.csv); --seed=S repeats a
+ * schedule and --ordered restores the fixed baseline-first order.
  */
 
 #include <iostream>
 #include <vector>
-#include <thread>
 #include <chrono>
 #include <fstream>
 #include <iomanip>
@@ -27,6 +39,21 @@
 #include <cmath>
 #include <string>
 #include <map>
+#include <sstream>
+#include <tuple>
+#include <random>
+
+#include "../common/cache_probe.h"
+#include "../common/arena.h"
+#include "../common/memstats.h"
+#include "../common/loop_nest.hpp"
+#include "../common/cost_model.h"
+#include "../common/rapl.h"
+#include "../common/cpufreq.h"
+#include "../common/fingerprint.h"
+#include "../common/scaling_fit.h"
+#include "../common/perf_model.h"
+#include "../lib/hpcmat.h"
 
 using namespace std;
 
@@ -35,23 +62,36 @@ using namespace std;
 // ============================================================================
 const int WARMUP_RUNS = 2;      // Warmup runs before timing
 const int TIMED_RUNS = 5;       // Number of timed runs (take minimum)
-const int BLOCK_SIZE = 32;      // Block size for tiled algorithm
+int BLOCK_SIZE = 32;            // Block size for tiled algorithm (libhpcmat's, from cache probe)
+int METHOD_W = 10;              // Method column of the console tables, widened for nest names
 
 // ============================================================================
 // GLOBAL DATA
 // ============================================================================
 int N;                              // Matrix dimension
 int NUM_THREADS;                    // Current thread count
-vector<vector<double>> A, B, C;     // Matrices
+typedef vector<double, HpcArenaAllocator<double>> Store;   // one arena block per matrix
+
+// Contiguous row-major N x N matrix, as hpc_gemm takes it; M[i] is row i,
+// which is all the generated nests need
+struct Mat {
+    double* p = nullptr;
+    double* operator[](int i) const { return p + (size_t)i * N; }
+};
+Store a_store, b_store, c_store;
+Mat A, B, C;                        // Matrices
 
 // ============================================================================
 // MATRIX OPERATIONS
 // ============================================================================
 void initialize_matrices(int size) {
     N = size;
-    A.assign(N, vector<double>(N));
-    B.assign(N, vector<double>(N));
-    C.assign(N, vector<double>(N, 0.0));
+    a_store.assign((size_t)N * N, 0.0);
+    b_store.assign((size_t)N * N, 0.0);
+    c_store.assign((size_t)N * N, 0.0);
+    A.p = a_store.data();
+    B.p = b_store.data();
+    C.p = c_store.data();
     
     // Initialize with deterministic values
     for (int i = 0; i < N; i++) {
@@ -62,125 +102,114 @@ void initialize_matrices(int size) {
     }
 }
 
-void reset_result() {
-    for (int i = 0; i < N; i++) {
-        for (int j = 0; j < N; j++) {
-            C[i][j] = 0.0;
-        }
-    }
-}
-
-// ============================================================================
-// ACCESS PATTERN 1: IJK (Standard/Naive)
-// ============================================================================
-void worker_ijk(int tid) {
-    int chunk = (N + NUM_THREADS - 1) / NUM_THREADS;
-    int start = tid * chunk;
-    int end = (start + chunk < N) ? start + chunk : N;
-
-    for (int i = start; i < end; i++) {
-        for (int j = 0; j < N; j++) {
-            double sum = 0.0;
-            for (int k = 0; k < N; k++) {
-                sum += A[i][k] * B[k][j];
-            }
-            C[i][j] = sum;
-        }
-    }
-}
-
-// ============================================================================
-// ACCESS PATTERN 2: IKJ (Optimized Row-Major)
-// ============================================================================
-void worker_ikj(int tid) {
-    int chunk = (N + NUM_THREADS - 1) / NUM_THREADS;
-    int start = tid * chunk;
-    int end = (start + chunk < N) ? start + chunk : N;
-
-    for (int i = start; i < end; i++) {
-        for (int k = 0; k < N; k++) {
-            double r = A[i][k];
-            for (int j = 0; j < N; j++) {
-                C[i][j] += r * B[k][j];
-            }
-        }
+// The five classic patterns are lib/hpcmat.c's hpc_gemm methods: IJK, IKJ
+// and Blocked split rows of C over the threads, JIK and JKI columns, and
+// every one stores the k == 0 term instead of accumulating into a zeroed C.
+// They run on a context per thread count, created with HPC_CTX_EXACT so the
+// library does not apply its own cutoff on top of active_threads(). The
+// loop nests run on the same pools through hpc_parallel, so every method
+// is timed with the same dispatch and none pays a thread spawn.
+hpc_ctx_t* gemm_ctx(int threads) {
+    static map<int, hpc_ctx_t*> ctxs;
+    hpc_ctx_t*& ctx = ctxs[threads];
+    if (!ctx) ctx = hpc_ctx_create(threads, HPC_CTX_EXACT);
+    if (!ctx) {
+        cerr << "hpc_ctx_create(" << threads << "): " << hpc_strerror(HPC_ENOMEM) << endl;
+        exit(1);
     }
+    return ctx;
 }
 
 // ============================================================================
-// ACCESS PATTERN 3: JIK (Column-Major for C)
+// GENERATED LOOP NESTS (loop_nest.hpp)
 // ============================================================================
-void worker_jik(int tid) {
+// Each thread owns a contiguous range of rows of C (columns for J-outer
+// orders), zeroes it and runs the nest over that range. K-outer orders
+// accumulate over the whole k range, so the slice is zeroed up front.
+template <class Nest>
+void worker_nest(int tid) {
+    constexpr int d = Nest::split_dim();
     int chunk = (N + NUM_THREADS - 1) / NUM_THREADS;
     int start = tid * chunk;
     int end = (start + chunk < N) ? start + chunk : N;
+    if (start >= end) return;
 
-    for (int j = start; j < end; j++) {
-        for (int i = 0; i < N; i++) {
-            double sum = 0.0;
-            for (int k = 0; k < N; k++) {
-                sum += A[i][k] * B[k][j];
-            }
-            C[i][j] = sum;
-        }
+    int lo[3] = {0, 0, 0}, hi[3] = {N, N, N};
+    lo[d] = start;
+    hi[d] = end;
+    if (d == NEST_I) {
+        for (int i = start; i < end; i++) fill(C[i], C[i] + N, 0.0);
+    } else {
+        for (int i = 0; i < N; i++) fill(C[i] + start, C[i] + end, 0.0);
     }
+    Nest::run(A, B, C, lo, hi);
 }
 
 // ============================================================================
-// ACCESS PATTERN 4: JKI (Worst Case)
+// BENCHMARK STRUCTURES
 // ============================================================================
-void worker_jki(int tid) {
-    int chunk = (N + NUM_THREADS - 1) / NUM_THREADS;
-    int start = tid * chunk;
-    int end = (start + chunk < N) ? start + chunk : N;
+// A method is either an hpc_gemm one (gemm >= 0) or a per-thread worker
+struct Method {
+    string name;
+    void (*func)(int);
+    int gemm = -1;
+};
 
-    for (int j = start; j < end; j++) {
-        for (int k = 0; k < N; k++) {
-            double r = B[k][j];
-            for (int i = 0; i < N; i++) {
-                C[i][j] += A[i][k] * r;
-            }
-        }
+// Generated methods are named "nest-" + the nest's own name, so "nest-IKJ"
+// stays apart from the classic IKJ in the timing tables and CSVs
+const string NEST_PREFIX = "nest-";
+
+#define NEST(D0, D1, D2, TI, TJ, TK, U) \
+    Method{NEST_PREFIX + LoopNest<NEST_##D0, NEST_##D1, NEST_##D2, TI, TJ, TK, U>::name(), \
+           worker_nest<LoopNest<NEST_##D0, NEST_##D1, NEST_##D2, TI, TJ, TK, U>>}
+#define NEST_ALL_ORDERS(TI, TJ, TK, U) \
+    NEST(I, J, K, TI, TJ, TK, U), NEST(I, K, J, TI, TJ, TK, U), NEST(J, I, K, TI, TJ, TK, U), \
+    NEST(J, K, I, TI, TJ, TK, U), NEST(K, I, J, TI, TJ, TK, U), NEST(K, J, I, TI, TJ, TK, U)
+
+// Generated methods: every order untiled and 64^3-tiled, unrolled by 4.
+// NEST_SWEEP instantiates tiles 32/64/128 x unroll 1/4/8 for all orders.
+vector<Method> nest_methods() {
+    vector<Method> all = {
+#ifdef NEST_SWEEP
+        NEST_ALL_ORDERS(0, 0, 0, 1),
+        NEST_ALL_ORDERS(0, 0, 0, 4),
+        NEST_ALL_ORDERS(32, 32, 32, 1), NEST_ALL_ORDERS(32, 32, 32, 4), NEST_ALL_ORDERS(32, 32, 32, 8),
+        NEST_ALL_ORDERS(64, 64, 64, 1), NEST_ALL_ORDERS(64, 64, 64, 4), NEST_ALL_ORDERS(64, 64, 64, 8),
+        NEST_ALL_ORDERS(128, 128, 128, 1), NEST_ALL_ORDERS(128, 128, 128, 4), NEST_ALL_ORDERS(128, 128, 128, 8),
+        NEST_ALL_ORDERS(32, 256, 128, 4),
+#else
+        NEST_ALL_ORDERS(0, 0, 0, 4),
+        NEST_ALL_ORDERS(64, 64, 64, 4),
+#endif
+    };
+    // unroll does not apply to J-innermost orders: drop identical variants
+    vector<Method> out;
+    for (auto& m : all) {
+        bool seen = false;
+        for (auto& o : out) seen = seen || o.name == m.name;
+        if (!seen) out.push_back(m);
     }
+    return out;
 }
 
-// ============================================================================
-// ACCESS PATTERN 5: Blocked/Tiled (Cache-Optimized)
-// ============================================================================
-void worker_blocked(int tid) {
-    int chunk = (N + NUM_THREADS - 1) / NUM_THREADS;
-    int start = tid * chunk;
-    int end = (start + chunk < N) ? start + chunk : N;
+// Best time of a configuration plus the page faults and memory use of that run
+struct Timing {
+    double seconds;
+    hpc_faults_t faults;
+    bool contaminated;
+    hpc_mem_t mem;
+    int active;         // threads that ran after the grain-size cutoff
+    hpc_energy_t energy;    // package / DRAM joules of that run (nan without RAPL)
+    hpc_freq_t freq;        // effective clock and cycles of that run
+};
 
-    for (int ii = start; ii < end; ii += BLOCK_SIZE) {
-        for (int kk = 0; kk < N; kk += BLOCK_SIZE) {
-            for (int jj = 0; jj < N; jj += BLOCK_SIZE) {
-                
-                int i_max = (ii + BLOCK_SIZE < end) ? ii + BLOCK_SIZE : end;
-                int k_max = (kk + BLOCK_SIZE < N) ? kk + BLOCK_SIZE : N;
-                int j_max = (jj + BLOCK_SIZE < N) ? jj + BLOCK_SIZE : N;
-
-                for (int i = ii; i < i_max; i++) {
-                    for (int k = kk; k < k_max; k++) {
-                        double r = A[i][k];
-                        for (int j = jj; j < j_max; j++) {
-                            C[i][j] += r * B[k][j];
-                        }
-                    }
-                }
-            }
-        }
-    }
+// Compulsory DRAM traffic: A and B read once, C written once plus its
+// write-allocate read. Same for every access pattern; the gap between this
+// and what a pattern really moves is what the patterns are about.
+double bytes_moved(int n) {
+    return 4.0 * sizeof(double) * n * n;
 }
 
-// ============================================================================
-// BENCHMARK STRUCTURES
-// ============================================================================
-struct Method {
-    string name;
-    void (*func)(int);
-};
-
 struct BenchmarkResult {
     int size;
     int threads;
@@ -189,134 +218,373 @@ struct BenchmarkResult {
     double gflops;
     double speedup;
     double efficiency;
+    hpc_faults_t faults;
+    bool contaminated;
+    hpc_mem_t mem;
 };
 
 // ============================================================================
 // EXECUTE ONE RUN (helper function)
 // ============================================================================
-void execute_once(void (*func)(int), int num_threads) {
+static void run_worker(void* arg, int tid, int) {
+    static_cast<const Method*>(arg)->func(tid);
+}
+
+void execute_once(const Method& m, int num_threads) {
     NUM_THREADS = num_threads;
-    reset_result();
     
-    if (num_threads == 1) {
-        func(0);
+    if (m.gemm >= 0) {
+        hpc_gemm(gemm_ctx(num_threads), m.gemm, N, N, N, A[0], N, B[0], N, C[0], N);
     } else {
-        vector<thread> pool;
-        for (int t = 0; t < num_threads; t++) {
-            pool.push_back(thread(func, t));
-        }
-        for (int t = 0; t < num_threads; t++) {
-            pool[t].join();
-        }
+        hpc_parallel(gemm_ctx(num_threads), run_worker, const_cast<Method*>(&m), num_threads);
     }
 }
 
 // ============================================================================
 // RUN BENCHMARK WITH WARMUP AND MINIMUM TIME
 // ============================================================================
-double run_benchmark(void (*func)(int), int num_threads) {
+// Below the grain-size cutoff extra threads cost more than they save; each
+// one costs a dispatch on the pool it would run on
+double dispatch_ns(int num_threads) {
+    return hpc_ctx_param(gemm_ctx(num_threads), HPC_PARAM_DISPATCH_NS);
+}
+
+int active_threads(int num_threads) {
+    const hpc_cost_model_t* cm = hpc_cost_model();
+    double work = hpc_cost_work_ns(cm, 2.0 * N * N * N, bytes_moved(N), 3.0 * sizeof(double) * N * N);
+    return hpc_auto_threads(cm, work, dispatch_ns(num_threads), num_threads);
+}
+
+// Loop order and tile of a method for the traffic model: the names ("JKI",
+// "nest-IKJ-t64u4") carry both; Blocked is IKJ over BLOCK_SIZE tiles
+hpc_pm_shape_t method_shape(const string& name) {
+    if (name == "Blocked") return hpc_pm_shape_gemm("IKJ", BLOCK_SIZE);
+    string order = name.compare(0, NEST_PREFIX.size(), NEST_PREFIX) == 0 ? name.substr(NEST_PREFIX.size()) : name;
+    size_t t = order.find("-t");
+    return hpc_pm_shape_gemm(order.c_str(), t == string::npos ? 0 : atoi(order.c_str() + t + 2));
+}
+
+// Predicted time of a configuration, with the same thread overhead as the cutoff
+hpc_pm_prediction_t predict(const string& name, int n, int active) {
+    hpc_pm_shape_t shape = method_shape(name);
+    return hpc_pm_predict(hpc_perf_model(), &shape, n, active, dispatch_ns(active));
+}
+
+// One timed run with the page faults, memory, energy and clock of that run
+Timing time_once(const Method& m, int num_threads) {
+    Timing t = {0, {0, 0}, false, {0, 0, 0, 0}, num_threads, {}, {}};
+    NUM_THREADS = num_threads;
+    hpc_mem_begin(&t.mem);
+    hpc_faults_begin(&t.faults);
+    hpc_energy_begin(&t.energy);
+    hpc_freq_begin(&t.freq);
+    
+    auto start_time = chrono::high_resolution_clock::now();
+    execute_once(m, num_threads);
+    auto end_time = chrono::high_resolution_clock::now();
+    hpc_freq_end(&t.freq);
+    hpc_energy_end(&t.energy);
+    hpc_faults_end(&t.faults);
+    hpc_mem_end(&t.mem);
+    chrono::duration<double> diff = end_time - start_time;
+    t.seconds = diff.count();
+    t.contaminated = hpc_faults_contaminated(&t.faults);
+    return t;
+}
+
+// Minimum filters out OS interference; you can't go faster than possible.
+// Runs that took page faults are only used when no clean run exists.
+void keep_best(Timing& best, const Timing& t) {
+    if ((best.contaminated && !t.contaminated) ||
+        (t.contaminated == best.contaminated && t.seconds < best.seconds)) {
+        best = t;
+    }
+}
+
+// cutoff = false runs every requested thread (weak scaling sizes the
+// problem for all of them)
+Timing run_benchmark(const Method& m, int num_threads, bool cutoff = true) {
+    if (cutoff) num_threads = active_threads(num_threads);
+
     // Warmup runs (results discarded)
     for (int w = 0; w < WARMUP_RUNS; w++) {
-        execute_once(func, num_threads);
+        execute_once(m, num_threads);
     }
     
     // Timed runs - take MINIMUM (standard benchmarking practice)
-    // Minimum filters out OS interference; you can't go faster than possible
-    double min_time = 1e9;
-    
+    Timing best = {1e9, {0, 0}, true, {0, 0, 0, 0}, num_threads, {}, {}};
     for (int r = 0; r < TIMED_RUNS; r++) {
-        NUM_THREADS = num_threads;
-        reset_result();
-        
-        auto start_time = chrono::high_resolution_clock::now();
-        
-        if (num_threads == 1) {
-            func(0);
-        } else {
-            vector<thread> pool;
-            for (int t = 0; t < num_threads; t++) {
-                pool.push_back(thread(func, t));
+        keep_best(best, time_once(m, num_threads));
+    }
+    
+    return best;  // Minimum over clean runs (best case)
+}
+
+// ============================================================================
+// INTERLEAVED SCHEDULE (default; --ordered for the fixed order)
+// ============================================================================
+// Timing every 1-thread baseline first and then methods and thread counts
+// in a fixed order lets thermal drift and the frequency ramp favour
+// whatever runs early. Here sizes come in shuffled order, and within a size
+// every configuration (method x thread count) is warmed up and then timed
+// once per round, TIMED_RUNS rounds, each round in a fresh random order;
+// a configuration keeps its minimum as before.
+//
+// A reference run (the fastest 1-thread method of the size) starts every
+// round and follows the last one; it is the minimum of REF_RUNS runs, so
+// one interrupted run does not read as drift. Its time relative to the
+// first reference is the drift, written to drift.csv; beyond DRIFT_LIMIT
+// the machine changed speed during the size and the comparison is flagged.
+const double DRIFT_LIMIT = 0.05;
+const int REF_RUNS = 3;
+
+typedef tuple<int, string, int> ConfigKey;   // size, method, threads
+
+void run_interleaved(const vector<int>& sizes, const vector<Method>& methods,
+                     const vector<int>& thread_counts, mt19937& rng, ofstream& drift_csv,
+                     map<ConfigKey, Timing>& timings, map<int, hpc_arena_stats_t>& arenas) {
+    vector<int> order = sizes;
+    shuffle(order.begin(), order.end(), rng);
+
+    vector<int> counts = thread_counts;
+    if (find(counts.begin(), counts.end(), 1) == counts.end()) counts.insert(counts.begin(), 1);
+
+    for (int size : order) {
+        initialize_matrices(size);
+        hpc_arena_stats(&arenas[size]);
+
+        struct Config { const Method* m; int threads; Timing best; };
+        vector<Config> configs;
+        for (auto& m : methods) {
+            for (int threads : counts) {
+                int active = active_threads(threads);
+                configs.push_back({&m, threads, {1e9, {0, 0}, true, {0, 0, 0, 0}, active, {}, {}}});
             }
-            for (int t = 0; t < num_threads; t++) {
-                pool[t].join();
+        }
+
+        // Warmups in shuffled order too; the 1-thread ones pick the reference
+        shuffle(configs.begin(), configs.end(), rng);
+        const Method* ref = &methods.front();
+        double ref_warm = 1e30;
+        for (auto& c : configs) {
+            for (int w = 0; w < WARMUP_RUNS; w++) {
+                auto t0 = chrono::high_resolution_clock::now();
+                execute_once(*c.m, c.best.active);
+                chrono::duration<double> d = chrono::high_resolution_clock::now() - t0;
+                if (c.threads == 1 && w == WARMUP_RUNS - 1 && d.count() < ref_warm) {
+                    ref_warm = d.count();
+                    ref = c.m;
+                }
             }
         }
-        
-        auto end_time = chrono::high_resolution_clock::now();
-        chrono::duration<double> diff = end_time - start_time;
-        double elapsed = diff.count();
-        
-        if (elapsed < min_time) {
-            min_time = elapsed;
+
+        double ref_first = 0, worst = 0;
+        for (int r = 0; r <= TIMED_RUNS; r++) {
+            double ref_time = 1e9;
+            for (int k = 0; k < REF_RUNS; k++) ref_time = min(ref_time, time_once(*ref, 1).seconds);
+            if (r == 0) ref_first = ref_time;
+            double drift = ref_time / ref_first;
+            worst = max(worst, fabs(drift - 1.0));
+            drift_csv << size << "," << r << "," << ref->name << "," << ref_time << "," << drift << "\n";
+            if (r == TIMED_RUNS) break;
+
+            shuffle(configs.begin(), configs.end(), rng);
+            for (auto& c : configs) {
+                keep_best(c.best, time_once(*c.m, c.best.active));
+            }
+        }
+
+        cout << "  " << size << "x" << size << ": " << configs.size() << " configurations x "
+             << TIMED_RUNS << " rounds, reference " << ref->name << " drift " << worst * 100.0 << "%"
+             << (worst > DRIFT_LIMIT ? "  [DRIFT: clock or thermal state changed, rerun]" : "") << "\n";
+        for (auto& c : configs) {
+            timings[ConfigKey(size, c.m->name, c.threads)] = c.best;
         }
     }
-    
-    return min_time;  // Return minimum (best case)
+}
+
+// ============================================================================
+// WEAK SCALING (--weak)
+// ============================================================================
+// The problem grows with the thread count from `base` at one thread:
+//   work     N = base * T^(1/3)   every thread keeps 2 x base^3 flops
+//   memory   N = base * T^(1/2)   every thread keeps 3 x 8 x base^2 bytes
+// Sizes are rounded to a multiple of 8. Weak efficiency is the per-thread
+// throughput relative to one thread, (flops_T / T / t_T) / (flops_1 / t_1),
+// which reduces to t_1 / t_T when the work per thread is exactly constant.
+// The grain-size cutoff is off here: every requested thread runs.
+int weak_size(int base, int threads, bool memory) {
+    double n = base * pow((double)threads, memory ? 1.0 / 2.0 : 1.0 / 3.0);
+    return max(8, (int)lround(n / 8.0) * 8);
+}
+
+void run_weak_scaling(const vector<Method>& methods, const vector<int>& thread_counts, int base) {
+    ofstream weak_csv("weak_scaling.csv");
+    hpc_fingerprint_sidecar("weak_scaling.csv", HPC_COMPILER_ID, HPC_CFLAGS);
+    weak_csv << "Mode,BaseSize,MatrixSize,Threads,Method,TimeSeconds,GFLOPS,WeakEfficiency,"
+             << "Contaminated,ActiveThreads\n";
+
+    for (bool memory : {false, true}) {
+        const char* mode = memory ? "memory" : "work";
+        cout << ">>> Weak scaling, constant " << mode << " per thread (base " << base << ")\n";
+        cout << string(70, '-') << endl;
+        cout << left << setw(10) << "Threads" << setw(10) << "Size" << setw(METHOD_W) << "Method"
+             << setw(12) << "Time(s)" << setw(10) << "GFLOPS" << "WeakEff" << endl;
+        cout << string(70, '-') << endl;
+
+        map<string, double> base_rate;   // flops per second per thread at the first count
+        for (int threads : thread_counts) {
+            int size = weak_size(base, threads, memory);
+            initialize_matrices(size);
+            for (auto& m : methods) {
+                Timing timing = run_benchmark(m, threads, false);
+                double flops = 2.0 * size * size * size;
+                double rate = flops / timing.seconds;
+                if (threads == thread_counts.front()) base_rate[m.name] = rate / thread_counts.front();
+                double eff = rate / threads / base_rate[m.name] * 100.0;
+
+                weak_csv << mode << "," << base << "," << size << "," << threads << "," << m.name << ","
+                         << timing.seconds << "," << rate / 1e9 << "," << eff << ","
+                         << timing.contaminated << "," << timing.active << "\n";
+                cout << left << setw(10) << threads << setw(10) << size << setw(METHOD_W) << m.name
+                     << setw(12) << timing.seconds << setw(10) << rate / 1e9 << eff << "%"
+                     << (timing.contaminated ? "  [page faults]" : "") << endl;
+            }
+        }
+        cout << endl;
+    }
 }
 
 // ============================================================================
 // MAIN PROGRAM
 // ============================================================================
-int main() {
+int main(int argc, char** argv) {
+    // Open the clock counters before any pool exists: inherited counts only
+    // follow threads created after them, and gemm_ctx() starts its workers
+    // long before the first timed run
+    hpc_freq_counters();
+
     // Configuration
     vector<int> sizes = {256, 512, 1024, 2048};
     vector<int> thread_counts = {1, 2, 4, 8, 16};
     
     // All 5 access patterns
     vector<Method> methods = {
-        {"IJK",     worker_ijk},
-        {"IKJ",     worker_ikj},
-        {"JIK",     worker_jik},
-        {"JKI",     worker_jki},
-        {"Blocked", worker_blocked}
+        {"IJK",     nullptr, HPC_GEMM_IJK},
+        {"IKJ",     nullptr, HPC_GEMM_IKJ},
+        {"JIK",     nullptr, HPC_GEMM_JIK},
+        {"JKI",     nullptr, HPC_GEMM_JKI},
+        {"Blocked", nullptr, HPC_GEMM_BLOCKED}
     };
+    int weak_base = 0;   // --weak[=N]: weak scaling from N (default: smallest size)
+    bool ordered = false;   // --ordered: the fixed baseline-first order
+    unsigned seed = random_device{}();   // --seed=S repeats a schedule
+    for (int a = 1; a < argc; a++) {
+        string arg = argv[a];
+        if (arg == "--nest") {
+            for (auto& m : nest_methods()) {
+                methods.push_back(m);
+                METHOD_W = max(METHOD_W, (int)m.name.size() + 2);
+            }
+        } else if (arg == "--weak") {
+            weak_base = sizes.front();
+        } else if (arg.rfind("--weak=", 0) == 0) {
+            weak_base = max(8, atoi(arg.c_str() + 7));
+        } else if (arg == "--ordered") {
+            ordered = true;
+        } else if (arg.rfind("--seed=", 0) == 0) {
+            seed = (unsigned)strtoul(arg.c_str() + 7, nullptr, 10);
+        }
+    }
+
+    // Tile size from the measured host cache instead of a fixed 32; the
+    // library sizes it, read it back for the report and the model
+    cache_info_t cache;
+    cache_probe_host(&cache);
+    BLOCK_SIZE = hpc_ctx_param(gemm_ctx(1), HPC_PARAM_ADD_TILE);
 
     // Storage for results
     vector<BenchmarkResult> all_results;
     
-    // Store single-thread times for speedup calculation
-    map<pair<int, string>, double> single_thread_times;
+    // Best timing of every (size, method, threads), filled by PHASE 1
+    map<ConfigKey, Timing> timings;
+    map<int, hpc_arena_stats_t> arenas;
 
     // Open output files
     ofstream csv_out("matmul_results.csv");
-    csv_out << "MatrixSize,Threads,Method,TimeSeconds,GFLOPS,Speedup,Efficiency\n";
+    hpc_fingerprint_sidecar("matmul_results.csv", HPC_COMPILER_ID, HPC_CFLAGS);
+    csv_out << "MatrixSize,Threads,Method,TimeSeconds,GFLOPS,Speedup,Efficiency,"
+            << "MinorFaults,MajorFaults,Contaminated,"
+            << "AllocBytes,FootprintBytes,PeakRSSDeltaKB,BytesMoved,ActiveThreads,"
+            << "PackageJoules,DramJoules,Watts,GFLOPSPerWatt,"
+            << "GHz,Cycles,FlopsPerCycle,FreqSource,"
+            << "PredictedSeconds,ModelRatio,ModelBound\n";
     
     ofstream speedup_csv("speedup_analysis.csv");
-    speedup_csv << "MatrixSize,Method,Threads,Speedup,Efficiency\n";
+    speedup_csv << "MatrixSize,Method,Threads,Speedup,Efficiency,"
+                << "MinorFaults,MajorFaults,Contaminated,"
+                << "AllocBytes,FootprintBytes,PeakRSSDeltaKB,BytesMoved\n";
 
     // Print header
     cout << "================================================================\n";
     cout << "  MATRIX MULTIPLICATION - MULTITHREADING PERFORMANCE ANALYSIS\n";
     cout << "================================================================\n";
-    cout << "  Comparing 5 Access Patterns with varying thread counts\n";
+    cout << "  Comparing " << methods.size() << " Access Patterns with varying thread counts\n";
     cout << "  Warmup runs: " << WARMUP_RUNS << ", Timed runs: " << TIMED_RUNS << " (minimum taken)\n";
+    cout << "  Blocked tile: " << BLOCK_SIZE << " (L1 " << (cache.l1_bytes >> 10) << "K"
+         << (cache.measured ? ", measured" : ", sysfs") << ")\n";
+    if (ordered) {
+        cout << "  Schedule: ordered (baselines first, then size/method/threads)\n";
+    } else {
+        cout << "  Schedule: interleaved, seed " << seed << " (--seed=" << seed << " repeats it)\n";
+    }
     cout << "================================================================\n\n";
     cout << fixed << setprecision(4);
 
     // ========================================================================
-    // PHASE 1: Collect single-thread baselines first
+    // PHASE 1: Measure every configuration
     // ========================================================================
-    cout << "Collecting single-thread baselines...\n";
-    for (int size : sizes) {
-        initialize_matrices(size);
-        for (auto& m : methods) {
-            double time_1thread = run_benchmark(m.func, 1);
-            single_thread_times[{size, m.name}] = time_1thread;
-            cout << "  " << size << "x" << size << " " << m.name << ": " << time_1thread << "s\n";
+    if (ordered) {
+        cout << "Collecting single-thread baselines...\n";
+        for (int size : sizes) {
+            initialize_matrices(size);
+            for (auto& m : methods) {
+                Timing t1 = run_benchmark(m, 1);
+                timings[ConfigKey(size, m.name, 1)] = t1;
+                cout << "  " << size << "x" << size << " " << m.name << ": " << t1.seconds << "s"
+                     << (t1.contaminated ? "  [page faults]" : "") << "\n";
+            }
         }
+        for (int size : sizes) {
+            initialize_matrices(size);
+            hpc_arena_stats(&arenas[size]);
+            for (auto& m : methods) {
+                for (int threads : thread_counts) {
+                    if (threads != 1) timings[ConfigKey(size, m.name, threads)] = run_benchmark(m, threads);
+                }
+            }
+        }
+    } else {
+        cout << "Timing all configurations, interleaved...\n";
+        ofstream drift_csv("drift.csv");
+        drift_csv << "MatrixSize,Round,Reference,TimeSeconds,Drift\n";
+        mt19937 rng(seed);
+        run_interleaved(sizes, methods, thread_counts, rng, drift_csv, timings, arenas);
     }
     cout << "\n";
 
     // ========================================================================
-    // PHASE 2: Run all benchmarks
+    // PHASE 2: Report all benchmarks
     // ========================================================================
     for (int size : sizes) {
-        initialize_matrices(size);
-        
         cout << ">>> Matrix Size: " << size << " x " << size << endl;
+        const hpc_arena_stats_t& arena = arenas[size];
+        cout << "    operands: " << arena.bytes_reserved / 1048576.0 << " MB reserved for "
+             << 3.0 * sizeof(double) * size * size / 1048576.0 << " MB of elements (one block per matrix)"
+             << endl;
         cout << string(70, '-') << endl;
         cout << left << setw(10) << "Threads" 
-             << setw(10) << "Method" 
+             << setw(METHOD_W) << "Method" 
              << setw(12) << "Time(s)" 
              << setw(10) << "GFLOPS"
              << setw(10) << "Speedup"
@@ -324,16 +592,12 @@ int main() {
         cout << string(70, '-') << endl;
         
         for (auto& m : methods) {
-            double time_1thread = single_thread_times[{size, m.name}];
+            double time_1thread = timings[ConfigKey(size, m.name, 1)].seconds;
             
             for (int threads : thread_counts) {
-                double time_taken;
-                
-                if (threads == 1) {
-                    time_taken = time_1thread;
-                } else {
-                    time_taken = run_benchmark(m.func, threads);
-                }
+                const Timing& timing = timings[ConfigKey(size, m.name, threads)];
+                double time_taken = timing.seconds;
+                hpc_pm_prediction_t pred = predict(m.name, size, timing.active);
                 
                 // Calculate metrics
                 double gflops = (2.0 * size * size * size) / (time_taken * 1e9);
@@ -349,23 +613,44 @@ int main() {
                 result.gflops = gflops;
                 result.speedup = speedup;
                 result.efficiency = efficiency;
+                result.faults = timing.faults;
+                result.contaminated = timing.contaminated;
+                result.mem = timing.mem;
                 all_results.push_back(result);
                 
                 // Write to CSV
                 csv_out << size << "," << threads << "," << m.name << ","
                         << time_taken << "," << gflops << "," 
-                        << speedup << "," << efficiency << "\n";
+                        << speedup << "," << efficiency << ","
+                        << timing.faults.minflt << "," << timing.faults.majflt << ","
+                        << timing.contaminated << ","
+                        << timing.mem.alloc_bytes << "," << timing.mem.footprint_bytes << ","
+                        << timing.mem.rss_peak_kb << "," << (long long)bytes_moved(size) << ","
+                        << timing.active << ","
+                        << timing.energy.pkg_j << "," << timing.energy.dram_j << ","
+                        << hpc_energy_joules(&timing.energy) / time_taken << ","
+                        << gflops / (hpc_energy_joules(&timing.energy) / time_taken) << ","
+                        << timing.freq.ghz << "," << timing.freq.total_cycles << ","
+                        << 2.0 * size * size * size / timing.freq.total_cycles << ","
+                        << hpc_freq_sources[timing.freq.source] << ","
+                        << pred.total_ns / 1e9 << "," << time_taken / (pred.total_ns / 1e9) << ","
+                        << hpc_pm_bound_names[pred.bound] << "\n";
                 
                 speedup_csv << size << "," << m.name << "," << threads << ","
-                            << speedup << "," << efficiency << "\n";
+                            << speedup << "," << efficiency << ","
+                            << timing.faults.minflt << "," << timing.faults.majflt << ","
+                            << timing.contaminated << ","
+                            << timing.mem.alloc_bytes << "," << timing.mem.footprint_bytes << ","
+                            << timing.mem.rss_peak_kb << "," << (long long)bytes_moved(size) << "\n";
                 
                 // Print to console
                 cout << left << setw(10) << threads 
-                     << setw(10) << m.name 
+                     << setw(METHOD_W) << m.name 
                      << setw(12) << time_taken 
                      << setw(10) << gflops
                      << setw(10) << speedup
-                     << efficiency << "%" << endl;
+                     << efficiency << "%"
+                     << (timing.contaminated ? "  [page faults]" : "") << endl;
             }
         }
         cout << endl;
@@ -436,6 +721,8 @@ int main() {
     cout << "5. SCALABILITY ANALYSIS\n";
     cout << "   - How performance changes with increasing threads\n";
     cout << "   - Strong scaling: fixed problem size, varying threads\n";
+    cout << "   - Weak scaling (--weak): problem grows with threads, efficiency =\n";
+    cout << "     per-thread GFLOPS / single-thread GFLOPS\n";
     cout << "   - Helps identify optimal thread count\n\n";
 
     // ========================================================================
@@ -460,14 +747,126 @@ int main() {
         cout << endl;
     }
 
+    // ========================================================================
+    // Scalability models
+    // ========================================================================
+    // Amdahl and USL fitted to each method's thread sweep, over the threads
+    // that actually ran (the grain-size cutoff may have used fewer). The
+    // limiting term at the largest count says what caps the speedup:
+    // contention sigma (p - 1), e.g. shared memory bandwidth, or coherency
+    // kappa p (p - 1), e.g. lines moving between cores.
+    ofstream fit_csv("scaling_fit.csv");
+    fit_csv << "MatrixSize,Method,Points,SerialFraction,AmdahlCeiling,AmdahlR2,"
+            << "Contention,Coherency,OptimalThreads,PeakSpeedup,USLR2\n";
+    map<string, hpc_scaling_fit_t> largest_fits;
+    for (int size : sizes) {
+        for (auto& m : methods) {
+            double t1 = timings[ConfigKey(size, m.name, 1)].seconds;
+            vector<double> p, sp;
+            for (int threads : thread_counts) {
+                const Timing& t = timings[ConfigKey(size, m.name, threads)];
+                p.push_back(t.active);
+                sp.push_back(t1 / t.seconds);
+            }
+            hpc_scaling_fit_t fit;
+            hpc_scaling_fit(p.data(), sp.data(), (int)p.size(), &fit);
+            if (size == largest_size) largest_fits[m.name] = fit;
+            fit_csv << size << "," << m.name << "," << fit.n_used << ","
+                    << fit.amdahl_s << "," << fit.amdahl_ceiling << "," << fit.amdahl_r2 << ","
+                    << fit.usl_sigma << "," << fit.usl_kappa << ","
+                    << fit.usl_p_opt << "," << fit.usl_peak << "," << fit.usl_r2 << "\n";
+        }
+    }
+    fit_csv.close();
+
+    int max_threads = *max_element(thread_counts.begin(), thread_counts.end());
+    cout << "================================================================\n";
+    cout << "  SCALABILITY MODELS (for " << largest_size << "x" << largest_size << ")\n";
+    cout << "================================================================\n";
+    cout << "  Amdahl: S(p) = 1 / (s + (1-s)/p), ceiling 1/s\n";
+    cout << "  USL:    S(p) = p / (1 + sigma(p-1) + kappa p(p-1)), peak at sqrt((1-sigma)/kappa)\n\n";
+    cout << left << setw(METHOD_W) << "Method" << setw(9) << "serial" << setw(9) << "ceiling"
+         << setw(10) << "sigma" << setw(10) << "kappa" << setw(9) << "p*" << setw(9) << "peak"
+         << setw(12) << "R2 (A/U)" << "limited by" << endl;
+    cout << string(86, '-') << endl;
+    for (auto& m : methods) {
+        const hpc_scaling_fit_t& f = largest_fits[m.name];
+        if (f.n_used == 0 || std::isnan(f.usl_sigma)) {
+            cout << left << setw(METHOD_W) << m.name << "not enough thread counts above 1\n";
+            continue;
+        }
+        double pm = max_threads;
+        const char* limit = f.usl_sigma * (pm - 1) >= f.usl_kappa * pm * (pm - 1) ? "contention" : "coherency";
+        ostringstream r2;
+        r2 << fixed << setprecision(2) << f.amdahl_r2 << "/" << f.usl_r2;
+        cout << left << setw(METHOD_W) << m.name << setprecision(3)
+             << setw(9) << f.amdahl_s << setw(9) << f.amdahl_ceiling
+             << setw(10) << f.usl_sigma << setw(10) << f.usl_kappa << setprecision(1)
+             << setw(9) << f.usl_p_opt << setw(9) << f.usl_peak
+             << setw(12) << r2.str() << limit << "\n";
+    }
+    cout << setprecision(4) << "\n";
+
+    // ========================================================================
+    // Analytical model check
+    // ========================================================================
+    // Measured / predicted from the cache-traffic model (perf_model.h). Far
+    // above 1 the kernel loses time the model does not see (conflict
+    // misses, a loop the compiler did not vectorize, interference); far
+    // below, it gains what the model does not credit (SIMD, prefetching).
+    const double MODEL_LIMIT = 2.0;
+    cout << "================================================================\n";
+    cout << "  MODEL CHECK (measured / predicted, flagged outside " << setprecision(1)
+         << 1.0 / MODEL_LIMIT << "x-" << MODEL_LIMIT << "x)\n" << setprecision(4);
+    cout << "================================================================\n";
+    cout << left << setw(max(METHOD_W, 14)) << "Method" << setw(12) << "predicted" << setw(12) << "measured"
+         << setw(9) << "ratio" << "bound (" << largest_size << "x" << largest_size << ", 1 thread)" << endl;
+    cout << string(70, '-') << endl;
+    for (auto& m : methods) {
+        const Timing& t = timings[ConfigKey(largest_size, m.name, 1)];
+        hpc_pm_prediction_t pred = predict(m.name, largest_size, t.active);
+        double ratio = t.seconds / (pred.total_ns / 1e9);
+        cout << left << setw(max(METHOD_W, 14)) << m.name << setw(12) << pred.total_ns / 1e9 << setw(12) << t.seconds
+             << setw(9) << setprecision(2) << ratio << setprecision(4) << hpc_pm_bound_names[pred.bound]
+             << (hpc_pm_deviates(t.seconds * 1e9, pred.total_ns, MODEL_LIMIT) ? "  <-- deviates" : "") << "\n";
+    }
+    int deviating = 0;
+    for (auto& r : all_results) {
+        hpc_pm_prediction_t pred = predict(r.method, r.size, timings[ConfigKey(r.size, r.method, r.threads)].active);
+        deviating += hpc_pm_deviates(r.time_seconds * 1e9, pred.total_ns, MODEL_LIMIT);
+    }
+    cout << "  " << deviating << " of " << all_results.size()
+         << " configurations deviate (ModelRatio in matmul_results.csv)\n\n";
+
+    // ========================================================================
+    // PHASE 4: Weak scaling (optional)
+    // ========================================================================
+    if (weak_base) {
+        cout << "================================================================\n";
+        cout << "  WEAK SCALING (problem grows with threads)\n";
+        cout << "================================================================\n\n";
+        run_weak_scaling(methods, thread_counts, weak_base);
+    }
+
     cout << "================================================================\n";
     cout << "  OUTPUT FILES GENERATED\n";
     cout << "================================================================\n";
     cout << "  1. matmul_results.csv    - Complete benchmark results\n";
     cout << "  2. speedup_analysis.csv  - Speedup and efficiency data\n";
+    if (weak_base) cout << "  3. weak_scaling.csv      - Weak scaling (constant work / memory per thread)\n";
+    cout << "  -  scaling_fit.csv       - Amdahl / USL parameters per size and method\n";
+    if (!ordered) cout << "  -  drift.csv             - Reference-run drift per size and round\n";
+    int contaminated = 0;
+    for (auto& r : all_results) contaminated += r.contaminated;
+    if (contaminated) {
+        cout << "  \n";
+        cout << "  WARNING: " << contaminated << " result(s) took page faults inside the\n";
+        cout << "  timed region (Contaminated=1 in matmul_results.csv).\n";
+    }
     cout << "  \n";
     cout << "  Run 'python plot_results.py' to generate comparison plots.\n";
     cout << "================================================================\n";
+    hpc_arena_print_stats(stdout);
 
     return 0;
 }
@@ -0,0 +1,407 @@
+/**
+ * Matrix Multiplication - Multi-Process Shared-Memory Mode
+ *
+ * C = A x B computed by several worker PROCESSES instead of threads.
+ * A, B and C live in one POSIX shared-memory segment (shm_open + mmap);
+ * every process attaches to it by name and computes one 2D block of C
+ * with the blocked IKJ kernel. Processes synchronize through a
+ * sense-reversing barrier whose counter lives in the segment and which
+ * sleeps on a shared futex after a short spin.
+ *
+ * USAGE:
+ *   ./matmul_shm N procs [repeats]          spawn procs-1 workers (fork + attach)
+ *   ./matmul_shm N procs repeats --external wait for workers started elsewhere
+ *   ./matmul_shm --attach NAME RANK         join an existing segment as RANK
+ *
+ * With --external the coordinator prints the segment name; each tenant
+ * then runs `--attach NAME r` for r = 1..procs-1 from its own process.
+ *
+ * Build: g++ -O3 -march=native matmul_shm.cpp -o matmul_shm -lm
+ */
+
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include <atomic>
+#include <climits>
+#include <new>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "../common/cache_probe.h"
+
+using namespace std;
+
+// ============================================================================
+// CONFIGURATION
+// ============================================================================
+const int WARMUP_RUNS = 1;
+const int SPIN_LIMIT = 4000;            // barrier spins before futex sleep
+const long WAIT_SLICE_NS = 10000000;    // longest futex sleep between failure checks
+const uint64_t SHM_MAGIC = 0x48504353484d4d31ULL;   // "HPCSHMM1"
+
+// ============================================================================
+// SHARED SEGMENT LAYOUT
+// ============================================================================
+// Header (one page) followed by A, B, C as flat row-major N x N arrays.
+struct alignas(64) ShmHeader {
+    uint64_t magic;
+    int N;
+    int procs;
+    int grid_rows;                      // process grid: grid_rows x grid_cols
+    int grid_cols;
+    int block;                          // tile edge used by every process
+    int repeats;
+    alignas(64) atomic<int> attached;   // processes that have mapped the segment
+    alignas(64) atomic<int> arrive;     // barrier arrival counter
+    alignas(64) atomic<int> sense;      // barrier phase, also the futex word
+    alignas(64) atomic<int> failed;     // set by any rank that hits an error
+};
+
+static_assert(atomic<int>::is_always_lock_free, "shared barrier needs lock-free int");
+
+static size_t header_bytes() {
+    return (sizeof(ShmHeader) + 4095) / 4096 * 4096;
+}
+
+static size_t segment_bytes(int N) {
+    return header_bytes() + 3 * (size_t)N * N * sizeof(double);
+}
+
+struct Segment {
+    ShmHeader* hdr;
+    double* A;
+    double* B;
+    double* C;
+    size_t bytes;
+};
+
+static Segment map_segment(void* base, int N) {
+    Segment s;
+    s.hdr = (ShmHeader*)base;
+    s.A = (double*)((char*)base + header_bytes());
+    s.B = s.A + (size_t)N * N;
+    s.C = s.B + (size_t)N * N;
+    s.bytes = segment_bytes(N);
+    return s;
+}
+
+// ============================================================================
+// CROSS-PROCESS BARRIER (sense-reversing, spin then futex)
+// ============================================================================
+static long futex(atomic<int>* addr, int op, int val, const struct timespec* timeout = nullptr) {
+    // No FUTEX_PRIVATE_FLAG: the word is shared between processes.
+    return syscall(SYS_futex, (int*)addr, op, val, timeout, nullptr, 0);
+}
+
+// Marks the run as failed and wakes every rank sleeping in the barrier
+static void shm_fail(ShmHeader* h) {
+    h->failed.store(1, memory_order_release);
+    futex(&h->sense, FUTEX_WAKE, INT_MAX);
+}
+
+// True once one of the coordinator's forked ranks has exited. The child is
+// left unreaped (WNOWAIT), so the check repeats and abort_run can reap it.
+static bool worker_exited(const vector<pid_t>* workers) {
+    if (!workers) return false;
+    for (pid_t pid : *workers) {
+        siginfo_t info;
+        info.si_pid = 0;
+        if (waitid(P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT) == 0 && info.si_pid == pid) return true;
+    }
+    return false;
+}
+
+// Returns false once any rank has failed: the remaining ranks will never
+// all arrive. Sleeps are bounded by WAIT_SLICE_NS, so a failure whose wake
+// came between the check and the futex wait is still seen. The coordinator
+// passes its forked ranks: one that exits before the barrier opens died
+// without shm_fail (crash, OOM kill) and fails the run in its place.
+static bool shm_barrier(ShmHeader* h, int& local_sense, const vector<pid_t>* workers = nullptr) {
+    local_sense = !local_sense;
+    if (h->arrive.fetch_add(1, memory_order_acq_rel) == h->procs - 1) {
+        h->arrive.store(0, memory_order_relaxed);
+        h->sense.store(local_sense, memory_order_release);
+        futex(&h->sense, FUTEX_WAKE, INT_MAX);
+        return true;
+    }
+    for (int spin = 0; spin < SPIN_LIMIT; spin++) {
+        if (h->sense.load(memory_order_acquire) == local_sense) return true;
+    }
+    const struct timespec slice = {0, WAIT_SLICE_NS};
+    while (h->sense.load(memory_order_acquire) != local_sense) {
+        if (h->failed.load(memory_order_acquire)) return false;
+        if (worker_exited(workers)) {
+            // A rank leaves after the last barrier opens; only before is it a death
+            if (h->sense.load(memory_order_acquire) == local_sense) return true;
+            shm_fail(h);
+            return false;
+        }
+        futex(&h->sense, FUTEX_WAIT, !local_sense, &slice);
+    }
+    return true;
+}
+
+// ============================================================================
+// BLOCK KERNEL: C[r0:r1, c0:c1] = A[r0:r1, :] x B[:, c0:c1]
+// ============================================================================
+static void gemm_block(const double* A, const double* B, double* C, int N,
+                       int r0, int r1, int c0, int c1, int bs) {
+    for (int i = r0; i < r1; i++) {
+        double* crow = C + (size_t)i * N;
+        for (int j = c0; j < c1; j++) crow[j] = 0.0;
+    }
+    for (int ii = r0; ii < r1; ii += bs) {
+        int i_max = min(ii + bs, r1);
+        for (int kk = 0; kk < N; kk += bs) {
+            int k_max = min(kk + bs, N);
+            for (int jj = c0; jj < c1; jj += bs) {
+                int j_max = min(jj + bs, c1);
+                for (int i = ii; i < i_max; i++) {
+                    const double* arow = A + (size_t)i * N;
+                    double* crow = C + (size_t)i * N;
+                    for (int k = kk; k < k_max; k++) {
+                        double r = arow[k];
+                        const double* brow = B + (size_t)k * N;
+                        for (int j = jj; j < j_max; j++) {
+                            crow[j] += r * brow[j];
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void pin_process(int rank) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    int cores = sysconf(_SC_NPROCESSORS_ONLN);
+    CPU_SET(rank % cores, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+}
+
+// ============================================================================
+// PER-RANK BODY (coordinator is rank 0)
+// ============================================================================
+// Returns the average seconds per repetition as seen by this rank, or a
+// negative value if another rank failed. workers: see shm_barrier.
+static double run_rank(Segment& s, int rank, const vector<pid_t>* workers = nullptr) {
+    ShmHeader* h = s.hdr;
+    int N = h->N;
+    int pr = rank / h->grid_cols;
+    int pc = rank % h->grid_cols;
+    int rows = (N + h->grid_rows - 1) / h->grid_rows;
+    int cols = (N + h->grid_cols - 1) / h->grid_cols;
+    int r0 = min(pr * rows, N), r1 = min(r0 + rows, N);
+    int c0 = min(pc * cols, N), c1 = min(c0 + cols, N);
+
+    pin_process(rank);
+    int local_sense = 0;
+
+    for (int w = 0; w < WARMUP_RUNS; w++) {
+        if (!shm_barrier(h, local_sense, workers)) return -1.0;
+        gemm_block(s.A, s.B, s.C, N, r0, r1, c0, c1, h->block);
+    }
+    if (!shm_barrier(h, local_sense, workers)) return -1.0;
+
+    auto t0 = chrono::high_resolution_clock::now();
+    for (int rep = 0; rep < h->repeats; rep++) {
+        gemm_block(s.A, s.B, s.C, N, r0, r1, c0, c1, h->block);
+        if (!shm_barrier(h, local_sense, workers)) return -1.0;
+    }
+    auto t1 = chrono::high_resolution_clock::now();
+    return chrono::duration<double>(t1 - t0).count() / h->repeats;
+}
+
+static int attach_main(const string& name, int rank) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) { perror("shm_open"); return 1; }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ShmHeader)) {
+        cerr << "segment " << name << " is not initialized\n";
+        close(fd);
+        return 1;
+    }
+    void* base = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) { perror("mmap"); return 1; }
+
+    ShmHeader* h = (ShmHeader*)base;
+    if (h->magic != SHM_MAGIC || rank <= 0 || rank >= h->procs ||
+        (size_t)st.st_size < segment_bytes(h->N)) {
+        cerr << "bad segment or rank " << rank << "\n";
+        shm_fail(h);
+        munmap(base, st.st_size);
+        return 1;
+    }
+    Segment s = map_segment(base, h->N);
+    h->attached.fetch_add(1);
+    double sec = run_rank(s, rank);
+    munmap(base, st.st_size);
+    return sec < 0.0 ? 1 : 0;
+}
+
+// Error exit of the coordinator: releases the ranks waiting in the
+// barrier, reaps the workers it forked (killing any that do not leave)
+// and drops the segment.
+static int abort_run(ShmHeader* h, const vector<pid_t>& workers, void* base, size_t bytes,
+                     const string& name) {
+    shm_fail(h);
+    for (pid_t pid : workers) {
+        int waited = 0;
+        while (waitpid(pid, nullptr, WNOHANG) == 0) {
+            if (++waited == 1000) {     // ~1 s: stuck outside the barrier
+                kill(pid, SIGKILL);
+                waitpid(pid, nullptr, 0);
+                break;
+            }
+            usleep(1000);
+        }
+    }
+    munmap(base, bytes);
+    shm_unlink(name.c_str());
+    return 1;
+}
+
+// ============================================================================
+// VERIFICATION: recompute a sample of C entries directly
+// ============================================================================
+static bool verify(const Segment& s, int N) {
+    uint64_t seed = 12345;
+    for (int t = 0; t < 64; t++) {
+        int i = (int)(cp_rand(&seed) % N);
+        int j = (int)(cp_rand(&seed) % N);
+        double ref = 0.0;
+        for (int k = 0; k < N; k++) ref += s.A[(size_t)i * N + k] * s.B[(size_t)k * N + j];
+        double got = s.C[(size_t)i * N + j];
+        if (fabs(got - ref) > 1e-9 * max(1.0, fabs(ref))) {
+            cerr << "mismatch at (" << i << "," << j << "): " << got << " vs " << ref << "\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if (argc >= 4 && string(argv[1]) == "--attach") {
+        return attach_main(argv[2], atoi(argv[3]));
+    }
+    if (argc < 3) {
+        cerr << "Usage: " << argv[0] << " N procs [repeats] [--external]\n"
+             << "       " << argv[0] << " --attach NAME RANK\n";
+        return 1;
+    }
+
+    int N = atoi(argv[1]);
+    int procs = atoi(argv[2]);
+    int repeats = (argc >= 4) ? atoi(argv[3]) : 3;
+    bool external = (argc >= 5 && string(argv[4]) == "--external");
+    if (N <= 0 || procs <= 0 || repeats <= 0) {
+        cerr << "N, procs and repeats must be positive\n";
+        return 1;
+    }
+
+    // Near-square process grid so each block of C has balanced edges
+    int grid_rows = (int)sqrt((double)procs);
+    while (procs % grid_rows != 0) grid_rows--;
+    int grid_cols = procs / grid_rows;
+
+    string name = "/hpc_matmul_" + to_string(getpid());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) { perror("shm_open"); return 1; }
+    size_t bytes = segment_bytes(N);
+    if (ftruncate(fd, bytes) != 0) { perror("ftruncate"); shm_unlink(name.c_str()); return 1; }
+    void* base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) { perror("mmap"); shm_unlink(name.c_str()); return 1; }
+
+    Segment s = map_segment(base, N);
+    ShmHeader* h = new (base) ShmHeader();
+    h->N = N;
+    h->procs = procs;
+    h->grid_rows = grid_rows;
+    h->grid_cols = grid_cols;
+    h->repeats = repeats;
+    cache_info_t cache;
+    cache_probe_host(&cache);
+    h->block = cache_tile_square(&cache, 3);
+    h->attached.store(1);
+
+    // Same deterministic values as matmul_patterns.cpp
+    for (int i = 0; i < N; i++) {
+        for (int j = 0; j < N; j++) {
+            s.A[(size_t)i * N + j] = (i + j) % 10 * 0.1;
+            s.B[(size_t)i * N + j] = (i - j + N) % 10 * 0.1;
+        }
+    }
+    // Publish the segment only once the header and operands are complete
+    atomic_thread_fence(memory_order_release);
+    h->magic = SHM_MAGIC;
+
+    cout << "segment " << name << ": N=" << N << " procs=" << procs
+         << " grid=" << grid_rows << "x" << grid_cols << " block=" << h->block << endl;
+
+    vector<pid_t> workers;     // forked ranks, reaped on an error exit
+    if (external) {
+        cout << "waiting for " << procs - 1 << " workers: "
+             << argv[0] << " --attach " << name << " <rank 1.." << procs - 1 << ">" << endl;
+    } else {
+        for (int r = 1; r < procs; r++) {
+            pid_t pid = fork();
+            if (pid < 0) { perror("fork"); shm_fail(h); break; }
+            if (pid == 0) {
+                // Child drops the inherited mapping and attaches by name like
+                // an unrelated process would.
+                munmap(base, bytes);
+                _exit(attach_main(name, r));
+            }
+            workers.push_back(pid);
+        }
+    }
+
+    while (h->attached.load() < procs && !h->failed.load()) {
+        if (worker_exited(&workers)) shm_fail(h);
+        usleep(1000);
+    }
+    if (h->failed.load()) {
+        cerr << "worker failed to attach\n";
+        return abort_run(h, workers, base, bytes, name);
+    }
+
+    double sec = run_rank(s, 0, &workers);
+    if (sec < 0.0) {
+        cerr << "worker failed during the run\n";
+        return abort_run(h, workers, base, bytes, name);
+    }
+
+    if (!external) {
+        while (wait(nullptr) > 0) {}
+    }
+
+    double gflops = (2.0 * N * N * N) / (sec * 1e9);
+    bool ok = verify(s, N);
+    double checksum = 0.0;
+    for (size_t i = 0; i < (size_t)N * N; i += (size_t)N * N / 16 + 1) checksum += s.C[i];
+
+    cout << "time=" << sec << "s GFLOPS=" << gflops << (ok ? " verified" : " WRONG") << endl;
+    cout << "CSV," << N << "," << procs << ",SHM-Blocked," << sec << "," << gflops
+         << "," << checksum << endl;
+
+    munmap(base, bytes);
+    shm_unlink(name.c_str());
+    return ok ? 0 : 1;
+}
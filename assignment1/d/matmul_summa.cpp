@@ -0,0 +1,212 @@
+/**
+ * Matrix Multiplication - Distributed SUMMA
+ *
+ * C = A x B on a pr x pc grid of ranks (SUMMA: Scalable Universal Matrix
+ * Multiplication Algorithm). Every rank owns one block of A, B and C. For
+ * each panel of width b along k, the owners broadcast the A panel along
+ * their grid row and the B panel along their grid column, and every rank
+ * accumulates C_local += A_panel x B_panel with the blocked IKJ kernel
+ * matmul_patterns.cpp uses (hpc_gemm_acc, HPC_GEMM_BLOCKED of lib/hpcmat.h).
+ *
+ * Broadcasts are double-buffered: panel k+1 is posted before panel k is
+ * multiplied, so a root's send and the receivers' transfer overlap the
+ * local compute (MPI_Ibcast under MPI, eager shared-memory slots under the
+ * local transport).
+ *
+ * USAGE:
+ *   ./matmul_summa N ranks [panel] [repeats]        built-in local transport
+ *   mpirun -np P ./matmul_summa_mpi N 0 [panel] [repeats]
+ *
+ * Build:
+ *   ../lib/build.sh
+ *   g++ -O3 -march=native matmul_summa.cpp ../lib/libhpcmat.a -o matmul_summa -lm -pthread
+ *   mpicxx -O3 -march=native -DHPC_USE_MPI matmul_summa.cpp ../lib/libhpcmat.a -o matmul_summa_mpi -lm -pthread
+ */
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+#include "../common/cache_probe.h"
+#include "../common/localcomm.h"
+#include "../common/arena.h"
+#include "../lib/hpcmat.h"
+
+using namespace std;
+
+typedef vector<double, HpcArenaAllocator<double>> Buffer;
+
+// ============================================================================
+// CONFIGURATION
+// ============================================================================
+const int WARMUP_RUNS = 1;
+const int DEFAULT_REPEATS = 3;
+
+// Same deterministic values as matmul_patterns.cpp, addressed globally
+static inline double a_val(int i, int j) { return (i + j) % 10 * 0.1; }
+static inline double b_val(int i, int j, int N) { return (i - j + N) % 10 * 0.1; }
+
+struct Grid {
+    int pr, pc;          // grid shape
+    int myrow, mycol;    // this rank's coordinates
+    lc_comm* row;        // ranks in my grid row (rank within == column index)
+    lc_comm* col;        // ranks in my grid column (rank within == row index)
+};
+
+// ============================================================================
+// SUMMA: local blocks are mb x nb (C), mb x kb (A), kb x nb (B)
+// ============================================================================
+static void summa(const Grid& g, int N, int panel, hpc_ctx_t* ctx,
+                  const Buffer& A_loc, const Buffer& B_loc, Buffer& C_loc,
+                  Buffer apanel[2], Buffer bpanel[2]) {
+    int mb = N / g.pr;        // rows of my A / C block
+    int nb = N / g.pc;        // cols of my B / C block
+    int acols = N / g.pc;     // cols of my A block
+    int npanels = N / panel;
+
+    fill(C_loc.begin(), C_loc.end(), 0.0);
+
+    lc_request areq[2], breq[2];
+    // Post panel p: owners pack their slice, everyone starts the broadcast
+    auto post = [&](int p) {
+        int buf = p & 1;
+        int kg = p * panel;
+        int aroot = kg / acols;               // grid column owning A[:, kg]
+        int broot = kg / mb;                  // grid row owning B[kg, :]
+        if (g.mycol == aroot) {
+            int off = kg - aroot * acols;
+            for (int i = 0; i < mb; i++)
+                copy(&A_loc[(size_t)i * acols + off], &A_loc[(size_t)i * acols + off] + panel,
+                     &apanel[buf][(size_t)i * panel]);
+        }
+        if (g.myrow == broot) {
+            int off = kg - broot * mb;
+            copy(&B_loc[(size_t)off * nb], &B_loc[(size_t)(off + panel) * nb], bpanel[buf].begin());
+        }
+        lc_ibcast(apanel[buf].data(), apanel[buf].size() * sizeof(double), aroot, g.row, &areq[buf]);
+        lc_ibcast(bpanel[buf].data(), bpanel[buf].size() * sizeof(double), broot, g.col, &breq[buf]);
+    };
+
+    post(0);
+    for (int p = 0; p < npanels; p++) {
+        int buf = p & 1;
+        lc_wait(&areq[buf]);
+        lc_wait(&breq[buf]);
+        if (p + 1 < npanels) post(p + 1);     // overlaps with the multiply below
+        hpc_gemm_acc(ctx, HPC_GEMM_BLOCKED, mb, nb, panel, apanel[buf].data(), panel,
+                     bpanel[buf].data(), nb, C_loc.data(), nb);
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        cerr << "Usage: " << argv[0] << " N ranks [panel] [repeats]\n"
+             << "  ranks is ignored under MPI (use mpirun -np)\n";
+        return 1;
+    }
+    int N = atoi(argv[1]);
+    int nranks = atoi(argv[2]);
+    int panel = (argc >= 4) ? atoi(argv[3]) : 0;
+    int repeats = (argc >= 5) ? atoi(argv[4]) : DEFAULT_REPEATS;
+
+    // One thread per rank, so the pool has no workers and forking the
+    // local ranks afterwards is safe; the tile is the library's
+    hpc_ctx_t* ctx = hpc_ctx_create(1, HPC_CTX_EXACT);
+    if (!ctx) {
+        cerr << "hpc_ctx_create: " << hpc_strerror(HPC_ENOMEM) << "\n";
+        return 1;
+    }
+    int bs = hpc_ctx_param(ctx, HPC_PARAM_ADD_TILE);
+    if (panel <= 0) panel = max(bs, 64);
+
+    // Near-square grid; the local transport needs the message cap up front
+    auto grid_rows = [](int P) {
+        int pr = (int)sqrt((double)P);
+        while (P % pr != 0) pr--;
+        return pr;
+    };
+    int pr0 = grid_rows(max(nranks, 1));
+    size_t max_msg = (size_t)N / pr0 * panel * sizeof(double);
+    max_msg = max(max_msg, (size_t)N / (max(nranks, 1) / pr0) * panel * sizeof(double));
+
+    int rank = lc_init(&argc, &argv, nranks, max_msg);
+    lc_comm* world = lc_world();
+    int P = lc_size(world);
+    int pr = grid_rows(P);
+    int pc = P / pr;
+    if (N % pr != 0 || N % pc != 0 || (N / pr) % panel != 0 || (N / pc) % panel != 0) {
+        if (rank == 0)
+            cerr << "N=" << N << " must split evenly into a " << pr << "x" << pc
+                 << " grid with panel " << panel << "\n";
+        hpc_ctx_destroy(ctx);
+        lc_finalize();
+        return 1;
+    }
+    int mb = N / pr, nb = N / pc;
+
+    Grid g;
+    g.pr = pr;
+    g.pc = pc;
+    g.myrow = lc_rank(world) / pc;
+    g.mycol = lc_rank(world) % pc;
+    g.row = lc_split(world, g.myrow, g.mycol);
+    g.col = lc_split(world, g.mycol, g.myrow);
+
+    // Local blocks generated in place - no scatter needed
+    Buffer A_loc((size_t)mb * nb), B_loc((size_t)mb * nb), C_loc((size_t)mb * nb);
+    for (int i = 0; i < mb; i++) {
+        for (int j = 0; j < nb; j++) {
+            int gi = g.myrow * mb + i, gj = g.mycol * nb + j;
+            A_loc[(size_t)i * nb + j] = a_val(gi, gj);
+            B_loc[(size_t)i * nb + j] = b_val(gi, gj, N);
+        }
+    }
+    Buffer apanel[2] = {Buffer((size_t)mb * panel), Buffer((size_t)mb * panel)};
+    Buffer bpanel[2] = {Buffer((size_t)panel * nb), Buffer((size_t)panel * nb)};
+
+    for (int w = 0; w < WARMUP_RUNS; w++) summa(g, N, panel, ctx, A_loc, B_loc, C_loc, apanel, bpanel);
+
+    double best = 1e9;
+    for (int r = 0; r < repeats; r++) {
+        lc_barrier(world);
+        double t0 = lc_wtime();
+        summa(g, N, panel, ctx, A_loc, B_loc, C_loc, apanel, bpanel);
+        lc_barrier(world);
+        best = min(best, lc_wtime() - t0);
+    }
+
+    // Check a sample of my C entries against direct dot products
+    double stats[2] = {0.0, 0.0};     // mismatches, checksum
+    uint64_t seed = 777 + rank;
+    for (int t = 0; t < 16; t++) {
+        int i = (int)(cp_rand(&seed) % mb), j = (int)(cp_rand(&seed) % nb);
+        int gi = g.myrow * mb + i, gj = g.mycol * nb + j;
+        double ref = 0.0;
+        for (int k = 0; k < N; k++) ref += a_val(gi, k) * b_val(k, gj, N);
+        if (fabs(C_loc[(size_t)i * nb + j] - ref) > 1e-9 * max(1.0, fabs(ref))) stats[0] += 1.0;
+    }
+    for (size_t i = 0; i < C_loc.size(); i += C_loc.size() / 16 + 1) stats[1] += C_loc[i];
+    double total[2];
+    lc_reduce_sum(stats, total, 2, 0, world);
+
+    if (rank == 0) {
+        double gflops = (2.0 * N * N * N) / (best * 1e9);
+        cout << "SUMMA N=" << N << " ranks=" << P << " grid=" << pr << "x" << pc
+             << " panel=" << panel << " block=" << bs
+#ifdef HPC_USE_MPI
+             << " transport=mpi"
+#else
+             << " transport=local-shm"
+#endif
+             << "\n";
+        cout << "time=" << best << "s GFLOPS=" << gflops
+             << (total[0] == 0.0 ? " verified" : " WRONG") << endl;
+        cout << "CSV," << N << "," << P << ",SUMMA," << best << "," << gflops << "," << total[1] << endl;
+    }
+    hpc_ctx_destroy(ctx);
+    int status = lc_finalize();
+    return (rank == 0 && total[0] != 0.0) ? 1 : status;
+}
@@ -469,6 +469,23 @@ def generate_text_report(df):
             gflops = subset[(subset['Method'] == method) & (subset['Threads'] == max_threads)]['GFLOPS'].values[0]
             f.write(f"  {method:<12} {gflops:.2f}\n")
         
+        if 'FlopsPerCycle' in df.columns and subset['GHz'].notna().any():
+            f.write("\n" + "-" * 70 + "\n")
+            f.write("  COMPARISON METHOD 5: CYCLE-NORMALIZED\n")
+            f.write("-" * 70 + "\n")
+            f.write("  Flops/cycle = 2 x N^3 / cycles of all threads\n")
+            f.write("  Removes the clock difference between 1 thread (turbo) and N threads\n\n")
+            f.write(f"  {'Method':<12} {'GHz (1T)':<12} {f'GHz ({max_threads}T)':<12} "
+                    f"{'F/c (1T)':<12} {f'F/c ({max_threads}T)':<12}\n")
+            f.write("  " + "-" * 60 + "\n")
+            
+            for method in methods:
+                r1 = subset[(subset['Method'] == method) & (subset['Threads'] == 1)].iloc[0]
+                rn = subset[(subset['Method'] == method) & (subset['Threads'] == max_threads)].iloc[0]
+                f.write(f"  {method:<12} {r1['GHz']:<12.2f} {rn['GHz']:<12.2f} "
+                        f"{r1['FlopsPerCycle']:<12.3f} {rn['FlopsPerCycle']:<12.3f}\n")
+            f.write(f"\n  Clock source: {subset['FreqSource'].iloc[0]}\n")
+        
         f.write("\n" + "=" * 70 + "\n")
         
     print("  ✓ plots/comparison_report.txt")
@@ -0,0 +1,222 @@
+/**
+ * Tile Task Scheduling - Static vs Cyclic vs Queue-Fed Workers
+ *
+ * Compares four ways of handing matadd / matmul work to threads:
+ *   static  - contiguous row chunks decided up front (matadd.cpp style)
+ *   cyclic  - every T-th row tile (add_cyclic_rows style)
+ *   mutex   - tiles pulled from a mutex-protected bounded queue
+ *   lockfree- tiles pulled from the Vyukov MPMC queue (mpmc_queue.hpp)
+ *
+ * The queue variants are genuinely multi-producer: each worker pushes its
+ * own slice of tile ids into a bounded queue (capacity smaller than the
+ * task count) and pops whatever is available, so tiles migrate from slow
+ * threads to fast ones.
+ *
+ * A tile is `grain` rows of C (matadd) or a grain x grain block of C
+ * (matmul). --straggler F makes thread 0 execute every tile F times,
+ * emulating a core shared with a noisy neighbour.
+ *
+ * USAGE: ./tile_queue_bench [threads] [--straggler F]
+ * Build: g++ -O3 -march=native -pthread tile_queue_bench.cpp -o tile_queue_bench
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+
+#include "../common/mpmc_queue.hpp"
+#include "../common/arena.h"
+
+using namespace std;
+
+// ============================================================================
+// CONFIGURATION
+// ============================================================================
+const int TIMED_RUNS = 5;
+const size_t QUEUE_CAPACITY = 256;
+
+enum Op { OP_ADD, OP_MATMUL };
+enum Strategy { STATIC_CHUNKS, CYCLIC, MUTEX_QUEUE, LOCKFREE_QUEUE };
+const char* STRATEGY_NAMES[] = {"static", "cyclic", "mutex", "lockfree"};
+
+struct Problem {
+    Op op;
+    int N;
+    int grain;
+    vector<double, HpcArenaAllocator<double>> A, B, C;
+    int tiles_per_row;   // matmul: tiles along j
+    int ntasks;
+};
+
+// ============================================================================
+// TILE KERNELS
+// ============================================================================
+static void run_tile(Problem& p, int task) {
+    int N = p.N, g = p.grain;
+    if (p.op == OP_ADD) {
+        int r0 = task * g, r1 = min(r0 + g, N);
+        const double* a = &p.A[(size_t)r0 * N];
+        const double* b = &p.B[(size_t)r0 * N];
+        double* c = &p.C[(size_t)r0 * N];
+        size_t n = (size_t)(r1 - r0) * N;
+        for (size_t k = 0; k < n; k++) c[k] = a[k] + b[k];
+    } else {
+        int ti = task / p.tiles_per_row, tj = task % p.tiles_per_row;
+        int i0 = ti * g, i1 = min(i0 + g, N);
+        int j0 = tj * g, j1 = min(j0 + g, N);
+        for (int i = i0; i < i1; i++) {
+            double* crow = &p.C[(size_t)i * N];
+            for (int j = j0; j < j1; j++) crow[j] = 0.0;
+            for (int k = 0; k < N; k++) {
+                double r = p.A[(size_t)i * N + k];
+                const double* brow = &p.B[(size_t)k * N];
+                for (int j = j0; j < j1; j++) crow[j] += r * brow[j];
+            }
+        }
+    }
+}
+
+// ============================================================================
+// WORKERS
+// ============================================================================
+struct RunState {
+    atomic<int> done{0};
+    int straggler = 1;
+};
+
+static inline void execute(Problem& p, RunState& st, int tid, int task) {
+    int reps = (tid == 0) ? st.straggler : 1;
+    for (int r = 0; r < reps; r++) run_tile(p, task);
+}
+
+template <typename Queue>
+static void queue_worker(Problem& p, RunState& st, Queue& q, int tid, int T) {
+    // Producer side: this thread's static slice; consumer side: anything
+    int next = tid * p.ntasks / T, end = (tid + 1) * p.ntasks / T;
+    int task;
+    while (st.done.load(memory_order_relaxed) < p.ntasks) {
+        while (next < end && q.try_push(next)) next++;
+        if (q.try_pop(task)) {
+            execute(p, st, tid, task);
+            st.done.fetch_add(1, memory_order_relaxed);
+        } else if (next >= end) {
+            this_thread::yield();
+        }
+    }
+}
+
+static double run_strategy(Problem& p, Strategy s, int T, int straggler) {
+    double best = 1e9;
+    for (int run = 0; run < TIMED_RUNS + 1; run++) {
+        RunState st;
+        st.straggler = straggler;
+        MpmcQueue<int> lf(QUEUE_CAPACITY);
+        MutexQueue<int> mq(QUEUE_CAPACITY);
+
+        auto t0 = chrono::high_resolution_clock::now();
+        vector<thread> pool;
+        for (int t = 0; t < T; t++) {
+            pool.emplace_back([&, t]() {
+                if (s == STATIC_CHUNKS) {
+                    int b = t * p.ntasks / T, e = (t + 1) * p.ntasks / T;
+                    for (int k = b; k < e; k++) execute(p, st, t, k);
+                } else if (s == CYCLIC) {
+                    for (int k = t; k < p.ntasks; k += T) execute(p, st, t, k);
+                } else if (s == MUTEX_QUEUE) {
+                    queue_worker(p, st, mq, t, T);
+                } else {
+                    queue_worker(p, st, lf, t, T);
+                }
+            });
+        }
+        for (auto& th : pool) th.join();
+        auto t1 = chrono::high_resolution_clock::now();
+        double el = chrono::duration<double>(t1 - t0).count();
+        if (run > 0) best = min(best, el);   // run 0 is warmup
+    }
+    return best;
+}
+
+static bool verify(const Problem& p) {
+    int N = p.N;
+    for (int t = 0; t < 16; t++) {
+        int i = (t * 7919) % N, j = (t * 104729) % N;
+        double ref;
+        if (p.op == OP_ADD) {
+            ref = p.A[(size_t)i * N + j] + p.B[(size_t)i * N + j];
+        } else {
+            ref = 0.0;
+            for (int k = 0; k < N; k++) ref += p.A[(size_t)i * N + k] * p.B[(size_t)k * N + j];
+        }
+        if (abs(p.C[(size_t)i * N + j] - ref) > 1e-9 * max(1.0, abs(ref))) return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int T = (argc >= 2 && argv[1][0] != '-') ? atoi(argv[1]) : (int)thread::hardware_concurrency();
+    int straggler = 1;
+    for (int a = 1; a + 1 < argc; a++)
+        if (string(argv[a]) == "--straggler") straggler = max(1, atoi(argv[a + 1]));
+    if (T < 1) T = 1;
+
+    struct Case { Op op; int N; vector<int> grains; };
+    vector<Case> cases = {
+        {OP_ADD,    1024, {1, 4, 16, 64}},
+        {OP_ADD,    2048, {1, 4, 16, 64}},
+        {OP_MATMUL,  512, {16, 32, 64, 128}},
+        {OP_MATMUL, 1024, {32, 64, 128}},
+    };
+
+    ofstream csv("tile_queue_results.csv");
+    csv << "Op,MatrixSize,Threads,Strategy,Grain,Tasks,TimeSeconds,Verified\n";
+
+    cout << "Threads: " << T << "  straggler factor: " << straggler << "\n";
+    cout << left << setw(8) << "Op" << setw(7) << "N" << setw(7) << "Grain" << setw(8) << "Tasks";
+    for (auto name : STRATEGY_NAMES) cout << setw(12) << name;
+    cout << "\n" << string(80, '-') << "\n";
+
+    for (auto& c : cases) {
+        Problem p;
+        p.op = c.op;
+        p.N = c.N;
+        p.A.assign((size_t)c.N * c.N, 0.0);
+        p.B.assign((size_t)c.N * c.N, 0.0);
+        p.C.assign((size_t)c.N * c.N, 0.0);
+        for (int i = 0; i < c.N; i++)
+            for (int j = 0; j < c.N; j++) {
+                p.A[(size_t)i * c.N + j] = (i + j) % 10 * 0.1;
+                p.B[(size_t)i * c.N + j] = (i - j + c.N) % 10 * 0.1;
+            }
+
+        for (int g : c.grains) {
+            p.grain = g;
+            int tiles = (c.N + g - 1) / g;
+            p.tiles_per_row = tiles;
+            p.ntasks = (c.op == OP_ADD) ? tiles : tiles * tiles;
+
+            const char* opname = c.op == OP_ADD ? "add" : "matmul";
+            cout << left << setw(8) << opname << setw(7) << c.N << setw(7) << g << setw(8) << p.ntasks;
+            for (int s = STATIC_CHUNKS; s <= LOCKFREE_QUEUE; s++) {
+                fill(p.C.begin(), p.C.end(), -1.0);
+                double sec = run_strategy(p, (Strategy)s, T, straggler);
+                bool ok = verify(p);
+                cout << setw(12) << fixed << setprecision(6) << sec;
+                csv << opname << "," << c.N << "," << T << "," << STRATEGY_NAMES[s] << ","
+                    << g << "," << p.ntasks << "," << setprecision(9) << sec << "," << ok << "\n";
+                if (!ok) cout << "(WRONG)";
+            }
+            cout << "\n";
+        }
+    }
+    cout << "\nResults written to tile_queue_results.csv\n";
+    hpc_arena_print_stats(stdout);
+    return 0;
+}
@@ -0,0 +1,22 @@
+#!/usr/bin/env bash
+set -e
+
+# Builds libhpcmat.so (soname libhpcmat.so.1) and libhpcmat.a next to
+# this script. The benchmarks link the static one:
+#   $CC $CFLAGS prog.c ../lib/libhpcmat.a -lm -pthread
+# a service links either, with -I<this dir> and -lhpcmat -pthread.
+cd "$(dirname "$0")"
+
+CC=${CC:-gcc}
+CFLAGS=${CFLAGS:-"-O3 -march=native"}   # -march=native enables the AVX2/FMA GEMV micro-kernel
+MAJOR=1
+MINOR=1
+
+# only the hpc_* API is exported; the common/ helpers stay internal
+$CC $CFLAGS -fPIC -fvisibility=hidden -pthread -c hpcmat.c -o hpcmat.o
+$CC -shared -pthread -Wl,-soname,libhpcmat.so.$MAJOR hpcmat.o -o libhpcmat.so.$MAJOR.$MINOR -lm
+ln -sf libhpcmat.so.$MAJOR.$MINOR libhpcmat.so.$MAJOR
+ln -sf libhpcmat.so.$MAJOR libhpcmat.so
+rm -f libhpcmat.a
+ar rcs libhpcmat.a hpcmat.o
+rm -f hpcmat.o
@@ -0,0 +1,633 @@
+/*
+ * hpcmat.c - kernels and thread pool behind hpcmat.h
+ *
+ * Every call packs its operands into an argument struct on the caller's
+ * stack and hands one job function to the context's pool; each thread
+ * derives its range from (tid, nthreads) with common/partition.h, so
+ * nothing is shared between calls. The only static state is the host
+ * description (cache sizes, cost model), filled once under pthread_once.
+ *
+ * Build with lib/build.sh; the common/ headers are compiled in.
+ */
+#define HPCMAT_BUILD
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+#include "hpcmat.h"
+#include "../common/cache_probe.h"
+#include "../common/partition.h"
+#include "../common/cost_model.h"
+
+/* ---- host parameters ---- */
+
+static hpc_cost_model_t host;       /* includes the cache description */
+static size_t host_align;           /* seam alignment of HPC_ADD_LINEAR */
+static pthread_once_t host_once = PTHREAD_ONCE_INIT;
+
+/* Lazily initialized helpers run here once, not racing in pool threads */
+static void host_init(void) {
+    host = *hpc_cost_model();
+    host_align = hpc_partition_align();
+}
+
+/* ---- thread pool ---- */
+
+typedef void (*hpc_job_fn)(const void *arg, int tid, int nthreads);
+
+typedef struct {
+    hpc_ctx_t *ctx;
+    int tid;
+} hpc_worker_t;
+
+struct hpc_ctx {
+    int threads;                /* pool size, caller included */
+    unsigned flags;
+    int add_tile, gemv_tile, gemv_chunk, gemv_panel;
+    int last_threads;
+    double dispatch_ns;         /* cost of one call per extra thread */
+
+    pthread_mutex_t call;       /* serializes calls on this context */
+    pthread_mutex_t lock;       /* guards the job fields below */
+    pthread_cond_t go, done;
+    unsigned long gen;          /* bumped per job; workers wait for a change */
+    int stop;
+    hpc_job_fn job;
+    const void *arg;
+    int active;                 /* threads taking part in the job */
+    int pending;                /* workers (not the caller) still running it */
+
+    int started;                /* workers created */
+    pthread_t *th;
+    hpc_worker_t *w;
+};
+
+static void *pool_worker(void *v) {
+    hpc_worker_t *w = (hpc_worker_t *)v;
+    hpc_ctx_t *c = w->ctx;
+    unsigned long seen = 0;
+    pthread_mutex_lock(&c->lock);
+    for (;;) {
+        while (c->gen == seen && !c->stop) pthread_cond_wait(&c->go, &c->lock);
+        if (c->stop) break;
+        seen = c->gen;
+        if (w->tid >= c->active) continue;
+        hpc_job_fn job = c->job;
+        const void *arg = c->arg;
+        int n = c->active;
+        pthread_mutex_unlock(&c->lock);
+        job(arg, w->tid, n);
+        pthread_mutex_lock(&c->lock);
+        if (--c->pending == 0) pthread_cond_signal(&c->done);
+    }
+    pthread_mutex_unlock(&c->lock);
+    return NULL;
+}
+
+/* Run job on threads 0..active-1, the caller being thread 0 */
+static void pool_run(hpc_ctx_t *c, hpc_job_fn job, const void *arg, int active) {
+    pthread_mutex_lock(&c->call);
+    c->last_threads = active;
+    if (active > 1) {
+        pthread_mutex_lock(&c->lock);
+        c->job = job;
+        c->arg = arg;
+        c->active = active;
+        c->pending = active - 1;
+        c->gen++;
+        pthread_cond_broadcast(&c->go);
+        pthread_mutex_unlock(&c->lock);
+    }
+    job(arg, 0, active);
+    if (active > 1) {
+        pthread_mutex_lock(&c->lock);
+        while (c->pending) pthread_cond_wait(&c->done, &c->lock);
+        pthread_mutex_unlock(&c->lock);
+    }
+    pthread_mutex_unlock(&c->call);
+}
+
+/* Threads for one call: the grain-size cutoff over the pool, and no more
+ * than there are rows (or columns) to split. The per-thread overhead is
+ * the pool's measured dispatch cost, not a thread spawn. */
+static int call_threads(const hpc_ctx_t *c, double flops, double bytes, double footprint, int parts) {
+    int t = c->threads;
+    if (t > 1 && !(c->flags & HPC_CTX_EXACT))
+        t = hpc_auto_threads(&host, hpc_cost_work_ns(&host, flops, bytes, footprint), c->dispatch_ns, t);
+    if (t > parts) t = parts;
+    return t < 1 ? 1 : t;
+}
+
+static void pool_stop(hpc_ctx_t *c) {
+    pthread_mutex_lock(&c->lock);
+    c->stop = 1;
+    pthread_cond_broadcast(&c->go);
+    pthread_mutex_unlock(&c->lock);
+    for (int t = 0; t < c->started; t++) pthread_join(c->th[t], NULL);
+}
+
+static void empty_job(const void *arg, int tid, int nthreads) {
+    (void)arg;
+    (void)tid;
+    (void)nthreads;
+}
+
+/* Wake-up and completion of the whole pool for an empty job, per extra
+ * thread; best of a few */
+static double pool_dispatch_ns(hpc_ctx_t *c) {
+    if (c->threads < 2) return 0.0;
+    double best = 1e30;
+    for (int r = 0; r < 16; r++) {
+        double t0 = cp_now_ns();
+        pool_run(c, empty_job, NULL, c->threads);
+        double t = cp_now_ns() - t0;
+        if (t < best) best = t;
+    }
+    c->last_threads = 0;
+    return best / (c->threads - 1);
+}
+
+hpc_ctx_t *hpc_ctx_create(int threads, unsigned flags) {
+    pthread_once(&host_once, host_init);
+    if (threads <= 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads <= 0) threads = 1;
+
+    hpc_ctx_t *c = (hpc_ctx_t *)calloc(1, sizeof(hpc_ctx_t));
+    if (!c) return NULL;
+    c->threads = threads;
+    c->flags = flags;
+    c->add_tile = cache_tile_square(&host.cache, 3);
+    c->gemv_tile = cache_tile_gemv(&host.cache);
+    c->gemv_chunk = cache_xblock(host.cache.l1_bytes);
+    c->gemv_panel = cache_xblock(host.cache.l2_bytes);
+    pthread_mutex_init(&c->call, NULL);
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->go, NULL);
+    pthread_cond_init(&c->done, NULL);
+
+    c->th = (pthread_t *)calloc(threads, sizeof(pthread_t));
+    c->w = (hpc_worker_t *)calloc(threads, sizeof(hpc_worker_t));
+    if (!c->th || !c->w) {
+        hpc_ctx_destroy(c);
+        return NULL;
+    }
+    for (int t = 1; t < threads; t++) {
+        c->w[c->started].ctx = c;
+        c->w[c->started].tid = t;
+        if (pthread_create(&c->th[c->started], NULL, pool_worker, &c->w[c->started]) != 0) {
+            hpc_ctx_destroy(c);
+            return NULL;
+        }
+        c->started++;
+    }
+    c->dispatch_ns = pool_dispatch_ns(c);
+    return c;
+}
+
+void hpc_ctx_destroy(hpc_ctx_t *ctx) {
+    if (!ctx) return;
+    pool_stop(ctx);
+    pthread_cond_destroy(&ctx->done);
+    pthread_cond_destroy(&ctx->go);
+    pthread_mutex_destroy(&ctx->lock);
+    pthread_mutex_destroy(&ctx->call);
+    free(ctx->w);
+    free(ctx->th);
+    free(ctx);
+}
+
+int hpc_ctx_param(const hpc_ctx_t *ctx, int param) {
+    if (!ctx) return HPC_EINVAL;
+    switch (param) {
+        case HPC_PARAM_THREADS: return ctx->threads;
+        case HPC_PARAM_ADD_TILE: return ctx->add_tile;
+        case HPC_PARAM_GEMV_TILE: return ctx->gemv_tile;
+        case HPC_PARAM_GEMV_CHUNK: return ctx->gemv_chunk;
+        case HPC_PARAM_GEMV_PANEL: return ctx->gemv_panel;
+        case HPC_PARAM_LAST_THREADS: return ctx->last_threads;
+        case HPC_PARAM_DISPATCH_NS: return (int)(ctx->dispatch_ns + 0.5);
+    }
+    return HPC_EINVAL;
+}
+
+/* ---- C = A + B ---- */
+
+typedef struct {
+    int pattern, m, n, lda, ldb, ldc, tile;
+    const double *A, *B;
+    double *C;
+} add_args;
+
+static void add_row(const add_args *a, int i, int j0, int j1) {
+    const double *restrict ar = a->A + (size_t)i * a->lda;
+    const double *restrict br = a->B + (size_t)i * a->ldb;
+    double *restrict cr = a->C + (size_t)i * a->ldc;
+    for (int j = j0; j < j1; j++) cr[j] = ar[j] + br[j];
+}
+
+static void add_job(const void *v, int tid, int T) {
+    const add_args *a = (const add_args *)v;
+    int m = a->m, n = a->n;
+    hpc_range_t rows = hpc_split(m, tid, T);
+    int r0 = (int)rows.begin, r1 = (int)rows.end;
+
+    switch (a->pattern) {
+    case HPC_ADD_COL: {
+        /* column seams on 64-byte lines: no line shared between threads */
+        hpc_range_t cols = hpc_split_aligned(n, sizeof(double), a->C, 64, tid, T);
+        for (int j = (int)cols.begin; j < (int)cols.end; j++)
+            for (int i = 0; i < m; i++)
+                a->C[(size_t)i * a->ldc + j] = a->A[(size_t)i * a->lda + j] + a->B[(size_t)i * a->ldb + j];
+        break;
+    }
+    case HPC_ADD_BLOCKED:
+        for (int ii = r0; ii < r1; ii += a->tile) {
+            int ie = ii + a->tile < r1 ? ii + a->tile : r1;
+            for (int jj = 0; jj < n; jj += a->tile) {
+                int je = jj + a->tile < n ? jj + a->tile : n;
+                for (int i = ii; i < ie; i++) add_row(a, i, jj, je);
+            }
+        }
+        break;
+    case HPC_ADD_LINEAR:
+        if (a->lda == n && a->ldb == n && a->ldc == n) {
+            hpc_range_t r = hpc_split_aligned((size_t)m * n, sizeof(double), a->C, host_align, tid, T);
+            const double *restrict A = a->A, *restrict B = a->B;
+            double *restrict C = a->C;
+            for (size_t k = r.begin; k < r.end; k++) C[k] = A[k] + B[k];
+        } else {
+            for (int i = r0; i < r1; i++) add_row(a, i, 0, n);
+        }
+        break;
+    case HPC_ADD_CYCLIC:
+        for (int i = tid; i < m; i += T) add_row(a, i, 0, n);
+        break;
+    case HPC_ADD_UNROLL4:
+        for (int i = r0; i < r1; i++) {
+            const double *restrict ar = a->A + (size_t)i * a->lda;
+            const double *restrict br = a->B + (size_t)i * a->ldb;
+            double *restrict cr = a->C + (size_t)i * a->ldc;
+            int j = 0;
+            for (; j + 3 < n; j += 4) {
+                cr[j]     = ar[j]     + br[j];
+                cr[j + 1] = ar[j + 1] + br[j + 1];
+                cr[j + 2] = ar[j + 2] + br[j + 2];
+                cr[j + 3] = ar[j + 3] + br[j + 3];
+            }
+            for (; j < n; j++) cr[j] = ar[j] + br[j];
+        }
+        break;
+    default:    /* HPC_ADD_ROW */
+        for (int i = r0; i < r1; i++) add_row(a, i, 0, n);
+    }
+}
+
+int hpc_add(hpc_ctx_t *ctx, int pattern, int m, int n,
+            const double *A, int lda, const double *B, int ldb, double *C, int ldc) {
+    if (!ctx || m < 0 || n < 0 || pattern < HPC_ADD_ROW || pattern > HPC_ADD_UNROLL4) return HPC_EINVAL;
+    if (m == 0 || n == 0) return HPC_OK;
+    if (!A || !B || !C || lda < n || ldb < n || ldc < n) return HPC_EINVAL;
+    add_args a = {pattern, m, n, lda, ldb, ldc, ctx->add_tile, A, B, C};
+    double elems = (double)m * n;
+    int parts = pattern == HPC_ADD_COL ? n : m;
+    pool_run(ctx, add_job, &a, call_threads(ctx, elems, 4.0 * sizeof(double) * elems,
+                                            3.0 * sizeof(double) * elems, parts));
+    return HPC_OK;
+}
+
+/* ---- y = A x ---- */
+
+typedef struct {
+    int pattern, m, n, lda, tile, chunk, panel;
+    const double *A, *x;
+    double *y;
+} gemv_args;
+
+/* Micro-kernel: R rows of A (R <= 8) against one chunk x[0..n), each row's
+ * partial sum held in a register for the whole chunk, so every load of x
+ * feeds R multiply-adds. store != 0 writes y, otherwise adds to it. */
+static inline __attribute__((always_inline))
+void gemv_micro(int R, const double *A, int lda, const double *x, int n, double *y, int store) {
+    const double *a[8];
+    double sum[8];
+    for (int r = 0; r < R; r++) a[r] = A + (size_t)r * lda;
+    int j = 0;
+#if defined(__AVX2__) && defined(__FMA__)
+    __m256d acc[8];
+    for (int r = 0; r < R; r++) acc[r] = _mm256_setzero_pd();
+    for (; j + 4 <= n; j += 4) {
+        __m256d xv = _mm256_loadu_pd(x + j);
+        for (int r = 0; r < R; r++)
+            acc[r] = _mm256_fmadd_pd(_mm256_loadu_pd(a[r] + j), xv, acc[r]);
+    }
+    for (int r = 0; r < R; r++) {
+        __m128d v = _mm_add_pd(_mm256_castpd256_pd128(acc[r]), _mm256_extractf128_pd(acc[r], 1));
+        sum[r] = _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+    }
+#else
+    for (int r = 0; r < R; r++) sum[r] = 0.0;
+    for (; j + 4 <= n; j += 4) {
+        double x0 = x[j], x1 = x[j + 1], x2 = x[j + 2], x3 = x[j + 3];
+        for (int r = 0; r < R; r++)
+            sum[r] += a[r][j] * x0 + a[r][j + 1] * x1 + a[r][j + 2] * x2 + a[r][j + 3] * x3;
+    }
+#endif
+    for (; j < n; j++)
+        for (int r = 0; r < R; r++) sum[r] += a[r][j] * x[j];
+    for (int r = 0; r < R; r++) y[r] = store ? sum[r] : y[r] + sum[r];
+}
+
+/* x is cut into chunks of kb; for each chunk, rows go through the
+ * micro-kernel 8 at a time (then 4, then 1). y is touched once per chunk. */
+static void gemv_rowblocked(int M, int K, int lda, const double *A, const double *x, double *y, int kb) {
+    for (int j0 = 0; j0 < K; j0 += kb) {
+        int n = (K - j0 < kb) ? K - j0 : kb;
+        int store = j0 == 0;
+        int i = 0;
+        for (; i + 8 <= M; i += 8) gemv_micro(8, A + (size_t)i * lda + j0, lda, x + j0, n, y + i, store);
+        for (; i + 4 <= M; i += 4) gemv_micro(4, A + (size_t)i * lda + j0, lda, x + j0, n, y + i, store);
+        for (; i < M; i++) gemv_micro(1, A + (size_t)i * lda + j0, lda, x + j0, n, y + i, store);
+    }
+}
+
+/* One thread's rows [0, M) of A and y; column patterns store the j = 0
+ * term first, so y never needs zeroing */
+static void gemv_rows(const gemv_args *g, int M, const double *A, double *y) {
+    int K = g->n, lda = g->lda;
+    const double *x = g->x;
+    switch (g->pattern) {
+    case HPC_GEMV_COL:
+        for (int i = 0; i < M; i++) y[i] = A[(size_t)i * lda] * x[0];
+        for (int j = 1; j < K; j++) {
+            double xj = x[j];
+            for (int i = 0; i < M; i++) y[i] += A[(size_t)i * lda + j] * xj;
+        }
+        break;
+    case HPC_GEMV_ROW_UNROLL4:
+        for (int i = 0; i < M; i++) {
+            const double *ar = A + (size_t)i * lda;
+            double sum = 0.0;
+            int j = 0;
+            for (; j <= K - 4; j += 4) {
+                sum += ar[j]     * x[j];
+                sum += ar[j + 1] * x[j + 1];
+                sum += ar[j + 2] * x[j + 2];
+                sum += ar[j + 3] * x[j + 3];
+            }
+            for (; j < K; j++) sum += ar[j] * x[j];
+            y[i] = sum;
+        }
+        break;
+    case HPC_GEMV_COL_UNROLL4:
+        for (int i = 0; i < M; i++) y[i] = A[(size_t)i * lda] * x[0];
+        for (int j = 1; j < K; j++) {
+            double xj = x[j];
+            int i = 0;
+            for (; i <= M - 4; i += 4) {
+                y[i]     += A[(size_t)i * lda + j]       * xj;
+                y[i + 1] += A[(size_t)(i + 1) * lda + j] * xj;
+                y[i + 2] += A[(size_t)(i + 2) * lda + j] * xj;
+                y[i + 3] += A[(size_t)(i + 3) * lda + j] * xj;
+            }
+            for (; i < M; i++) y[i] += A[(size_t)i * lda + j] * xj;
+        }
+        break;
+    case HPC_GEMV_BLOCKED:
+        for (int ii = 0; ii < M; ii += g->tile) {
+            int imax = ii + g->tile < M ? ii + g->tile : M;
+            for (int jj = 0; jj < K; jj += g->tile) {
+                int jmax = jj + g->tile < K ? jj + g->tile : K;
+                for (int i = ii; i < imax; i++) {
+                    const double *ar = A + (size_t)i * lda;
+                    double sum = jj ? y[i] : 0.0;
+                    for (int j = jj; j < jmax; j++) sum += ar[j] * x[j];
+                    y[i] = sum;
+                }
+            }
+        }
+        break;
+    case HPC_GEMV_PTR:
+        for (int i = 0; i < M; i++) {
+            const double *pA = A + (size_t)i * lda;
+            const double *px = x;
+            double sum = 0.0;
+            for (int j = 0; j < K; j++) sum += (*pA++) * (*px++);
+            y[i] = sum;
+        }
+        break;
+    case HPC_GEMV_REGBLOCK:
+        gemv_rowblocked(M, K, lda, A, x, y, g->chunk);
+        break;
+    case HPC_GEMV_PANEL:
+        gemv_rowblocked(M, K, lda, A, x, y, g->panel);
+        break;
+    default:    /* HPC_GEMV_ROW */
+        for (int i = 0; i < M; i++) {
+            const double *ar = A + (size_t)i * lda;
+            double sum = 0.0;
+            for (int j = 0; j < K; j++) sum += ar[j] * x[j];
+            y[i] = sum;
+        }
+    }
+}
+
+static void gemv_job(const void *v, int tid, int T) {
+    const gemv_args *g = (const gemv_args *)v;
+    /* row seams on 64-byte lines of y: no line of y shared between threads */
+    hpc_range_t r = hpc_split_aligned(g->m, sizeof(double), g->y, 64, tid, T);
+    if (r.begin >= r.end) return;
+    gemv_rows(g, (int)(r.end - r.begin), g->A + r.begin * (size_t)g->lda, g->y + r.begin);
+}
+
+int hpc_gemv(hpc_ctx_t *ctx, int pattern, int m, int n, const double *A, int lda, const double *x, double *y) {
+    if (!ctx || m < 0 || n < 0 || pattern < HPC_GEMV_ROW || pattern > HPC_GEMV_PANEL) return HPC_EINVAL;
+    if (m == 0) return HPC_OK;
+    if (!y) return HPC_EINVAL;
+    if (n == 0) {
+        memset(y, 0, (size_t)m * sizeof(double));
+        return HPC_OK;
+    }
+    if (!A || !x || lda < n) return HPC_EINVAL;
+    gemv_args g = {pattern, m, n, lda, ctx->gemv_tile, ctx->gemv_chunk, ctx->gemv_panel, A, x, y};
+    double elems = (double)m * n;
+    pool_run(ctx, gemv_job, &g, call_threads(ctx, 2.0 * elems, sizeof(double) * (elems + n + 2.0 * m),
+                                             sizeof(double) * (elems + n + m), (m + 7) / 8));
+    return HPC_OK;
+}
+
+/* ---- C = A B ---- */
+
+typedef struct {
+    int method, m, n, k, lda, ldb, ldc, tile;
+    int acc;                    /* C += A B instead of C = A B */
+    const double *A, *B;
+    double *C;
+} gemm_args;
+
+#define GA(i, p) g->A[(size_t)(i) * g->lda + (p)]
+#define GB(p, j) g->B[(size_t)(p) * g->ldb + (j)]
+#define GC(i, j) g->C[(size_t)(i) * g->ldc + (j)]
+
+/* Unless acc is set, every method overwrites its part of C: the p == 0
+ * term is stored instead of accumulated, so C needs no zero fill */
+static void gemm_job(const void *v, int tid, int T) {
+    const gemm_args *g = (const gemm_args *)v;
+    int m = g->m, n = g->n, K = g->k;
+    /* IJK, IKJ and Blocked split rows of C, JIK and JKI columns */
+    int by_cols = g->method == HPC_GEMM_JIK || g->method == HPC_GEMM_JKI;
+    hpc_range_t r = by_cols ? hpc_split_aligned(n, sizeof(double), g->C, 64, tid, T) : hpc_split(m, tid, T);
+    int start = (int)r.begin, end = (int)r.end;
+
+    switch (g->method) {
+    case HPC_GEMM_IJK:
+        for (int i = start; i < end; i++)
+            for (int j = 0; j < n; j++) {
+                double sum = 0.0;
+                for (int p = 0; p < K; p++) sum += GA(i, p) * GB(p, j);
+                GC(i, j) = g->acc ? GC(i, j) + sum : sum;
+            }
+        break;
+    case HPC_GEMM_IKJ:
+        for (int i = start; i < end; i++) {
+            double *restrict crow = &GC(i, 0);
+            int p = 0;
+            if (!g->acc) {
+                double r0 = GA(i, 0);
+                const double *restrict b0 = &GB(0, 0);
+                for (int j = 0; j < n; j++) crow[j] = r0 * b0[j];
+                p = 1;
+            }
+            for (; p < K; p++) {
+                double rp = GA(i, p);
+                const double *restrict brow = &GB(p, 0);
+                for (int j = 0; j < n; j++) crow[j] += rp * brow[j];
+            }
+        }
+        break;
+    case HPC_GEMM_JIK:
+        for (int j = start; j < end; j++)
+            for (int i = 0; i < m; i++) {
+                double sum = 0.0;
+                for (int p = 0; p < K; p++) sum += GA(i, p) * GB(p, j);
+                GC(i, j) = g->acc ? GC(i, j) + sum : sum;
+            }
+        break;
+    case HPC_GEMM_JKI:
+        for (int j = start; j < end; j++) {
+            int p = 0;
+            if (!g->acc) {
+                double r0 = GB(0, j);
+                for (int i = 0; i < m; i++) GC(i, j) = GA(i, 0) * r0;
+                p = 1;
+            }
+            for (; p < K; p++) {
+                double rp = GB(p, j);
+                for (int i = 0; i < m; i++) GC(i, j) += GA(i, p) * rp;
+            }
+        }
+        break;
+    default: {  /* HPC_GEMM_BLOCKED */
+        int bs = g->tile;
+        for (int ii = start; ii < end; ii += bs) {
+            int i_max = ii + bs < end ? ii + bs : end;
+            for (int kk = 0; kk < K; kk += bs) {
+                int k_max = kk + bs < K ? kk + bs : K;
+                for (int jj = 0; jj < n; jj += bs) {
+                    int j_max = jj + bs < n ? jj + bs : n;
+                    for (int i = ii; i < i_max; i++) {
+                        double *restrict crow = &GC(i, 0);
+                        int p = kk;
+                        if (kk == 0 && !g->acc) {
+                            double r0 = GA(i, 0);
+                            const double *restrict b0 = &GB(0, 0);
+                            for (int j = jj; j < j_max; j++) crow[j] = r0 * b0[j];
+                            p = 1;
+                        }
+                        for (; p < k_max; p++) {
+                            double rp = GA(i, p);
+                            const double *restrict brow = &GB(p, 0);
+                            for (int j = jj; j < j_max; j++) crow[j] += rp * brow[j];
+                        }
+                    }
+                }
+            }
+        }
+    }
+    }
+}
+
+#undef GA
+#undef GB
+#undef GC
+
+static int gemm_call(hpc_ctx_t *ctx, int method, int m, int n, int k, const double *A, int lda,
+                     const double *B, int ldb, double *C, int ldc, int acc) {
+    if (!ctx || m < 0 || n < 0 || k < 0 || method < HPC_GEMM_IJK || method > HPC_GEMM_BLOCKED) return HPC_EINVAL;
+    if (m == 0 || n == 0) return HPC_OK;
+    if (!C || ldc < n) return HPC_EINVAL;
+    if (k == 0) {
+        if (!acc)
+            for (int i = 0; i < m; i++) memset(C + (size_t)i * ldc, 0, (size_t)n * sizeof(double));
+        return HPC_OK;
+    }
+    if (!A || !B || lda < k || ldb < n) return HPC_EINVAL;
+    gemm_args g = {method, m, n, k, lda, ldb, ldc, ctx->add_tile, acc, A, B, C};
+    int parts = method == HPC_GEMM_JIK || method == HPC_GEMM_JKI ? n : m;
+    double elems = (double)m * k + (double)k * n + (double)m * n;
+    pool_run(ctx, gemm_job, &g, call_threads(ctx, 2.0 * m * n * (double)k,
+                                             sizeof(double) * (elems + (double)m * n),
+                                             sizeof(double) * elems, parts));
+    return HPC_OK;
+}
+
+int hpc_gemm(hpc_ctx_t *ctx, int method, int m, int n, int k,
+             const double *A, int lda, const double *B, int ldb, double *C, int ldc) {
+    return gemm_call(ctx, method, m, n, k, A, lda, B, ldb, C, ldc, 0);
+}
+
+int hpc_gemm_acc(hpc_ctx_t *ctx, int method, int m, int n, int k,
+                 const double *A, int lda, const double *B, int ldb, double *C, int ldc) {
+    return gemm_call(ctx, method, m, n, k, A, lda, B, ldb, C, ldc, 1);
+}
+
+/* ---- caller's own kernels ---- */
+
+typedef struct {
+    void (*fn)(void *arg, int tid, int nthreads);
+    void *arg;
+} user_args;
+
+static void user_job(const void *v, int tid, int T) {
+    const user_args *u = (const user_args *)v;
+    u->fn(u->arg, tid, T);
+}
+
+int hpc_parallel(hpc_ctx_t *ctx, void (*fn)(void *arg, int tid, int nthreads), void *arg, int nthreads) {
+    if (!ctx || !fn) return HPC_EINVAL;
+    if (nthreads <= 0 || nthreads > ctx->threads) nthreads = ctx->threads;
+    user_args u = {fn, arg};
+    pool_run(ctx, user_job, &u, nthreads);
+    return HPC_OK;
+}
+
+/* ---- misc ---- */
+
+const char *hpc_strerror(int code) {
+    switch (code) {
+        case HPC_OK: return "success";
+        case HPC_EINVAL: return "invalid argument";
+        case HPC_ENOMEM: return "cannot create thread pool";
+    }
+    return "unknown error";
+}
+
+int hpcmat_version(void) {
+    return HPCMAT_VERSION_MAJOR * 100 + HPCMAT_VERSION_MINOR;
+}
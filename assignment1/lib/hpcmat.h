@@ -0,0 +1,130 @@
+/*
+ * hpcmat.h - matrix add, GEMV and GEMM kernels behind a stable C ABI
+ *
+ * The kernels of the assignment programs (b/ add, c/ GEMV, d/ GEMM) as a
+ * library: libhpcmat.so / libhpcmat.a, built by lib/build.sh.
+ *
+ *   hpc_ctx_t *ctx = hpc_ctx_create(0, 0);          one pool per core
+ *   hpc_gemm(ctx, HPC_GEMM_BLOCKED, m, n, k, A, lda, B, ldb, C, ldc);
+ *   hpc_ctx_destroy(ctx);
+ *
+ * A context owns a pool of worker threads, started once and parked on a
+ * condition variable between calls; the calling thread works as thread 0.
+ * There is no global state besides the host's cache and cost parameters,
+ * read once per process: separate contexts run concurrently, and calls on
+ * one context from several threads are serialized. Unless the context was
+ * created with HPC_CTX_EXACT, every call runs on the number of threads
+ * the grain-size cutoff (common/cost_model.h) picks for its size.
+ *
+ * Matrices are row-major doubles with a leading dimension (elements
+ * between the starts of consecutive rows, >= the row length). Outputs are
+ * overwritten, never accumulated into, except by hpc_gemm_acc. Patterns
+ * and methods are the ones the benchmarks compare; the fastest are
+ * HPC_ADD_ROW, HPC_GEMV_REGBLOCK and HPC_GEMM_BLOCKED.
+ *
+ * Compatibility: the functions and enum values below keep their meaning
+ * within a major version (HPCMAT_VERSION_MAJOR, the soname's number); new
+ * ones are only added. Functions return HPC_OK or a negative HPC_E* code.
+ */
+#ifndef HPCMAT_H
+#define HPCMAT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HPCMAT_VERSION_MAJOR 1
+#define HPCMAT_VERSION_MINOR 1
+
+#if defined(HPCMAT_BUILD)
+#define HPC_API __attribute__((visibility("default")))
+#else
+#define HPC_API
+#endif
+
+typedef struct hpc_ctx hpc_ctx_t;
+
+enum {
+    HPC_OK = 0,
+    HPC_EINVAL = -1,    /* bad dimension, leading dimension, pattern or pointer */
+    HPC_ENOMEM = -2,    /* the pool's threads or memory could not be created */
+};
+
+/* hpc_ctx_create flags */
+enum {
+    HPC_CTX_EXACT = 1,  /* always use every pool thread, no grain-size cutoff */
+};
+
+/* C = A + B, m x n; patterns of b/optimized_matadd.c */
+enum {
+    HPC_ADD_ROW = 0,        /* contiguous row ranges */
+    HPC_ADD_COL = 1,        /* column ranges, walked down the columns */
+    HPC_ADD_BLOCKED = 2,    /* row ranges in L1-sized tiles */
+    HPC_ADD_LINEAR = 3,     /* one flat range (row order when not contiguous) */
+    HPC_ADD_CYCLIC = 4,     /* every nthreads-th row */
+    HPC_ADD_UNROLL4 = 5,    /* row ranges, inner loop unrolled by 4 */
+};
+
+/* y = A x, A m x n; patterns of c/c.c */
+enum {
+    HPC_GEMV_ROW = 0,           /* dot product per row */
+    HPC_GEMV_COL = 1,           /* axpy per column */
+    HPC_GEMV_ROW_UNROLL4 = 2,
+    HPC_GEMV_COL_UNROLL4 = 3,
+    HPC_GEMV_BLOCKED = 4,       /* square tiles, x chunk in L1 */
+    HPC_GEMV_PTR = 5,           /* dot product per row, pointer walk */
+    HPC_GEMV_REGBLOCK = 6,      /* 8 rows per x chunk in registers, chunk in L1 (AVX2/FMA) */
+    HPC_GEMV_PANEL = 7,         /* as REGBLOCK with an L2-sized x panel, for wide A */
+};
+
+/* C = A B, A m x k, B k x n; loop orders of d/matmul_patterns.cpp */
+enum {
+    HPC_GEMM_IJK = 0,
+    HPC_GEMM_IKJ = 1,
+    HPC_GEMM_JIK = 2,
+    HPC_GEMM_JKI = 3,
+    HPC_GEMM_BLOCKED = 4,   /* IKJ over square tiles sized to L1 */
+};
+
+/* hpc_ctx_param keys */
+enum {
+    HPC_PARAM_THREADS = 0,      /* pool size, caller included */
+    HPC_PARAM_ADD_TILE = 1,     /* tile edge of HPC_ADD_BLOCKED and HPC_GEMM_BLOCKED */
+    HPC_PARAM_GEMV_TILE = 2,    /* tile edge of HPC_GEMV_BLOCKED */
+    HPC_PARAM_GEMV_CHUNK = 3,   /* x chunk of HPC_GEMV_REGBLOCK */
+    HPC_PARAM_GEMV_PANEL = 4,   /* x panel of HPC_GEMV_PANEL */
+    HPC_PARAM_LAST_THREADS = 5, /* threads the last call ran on */
+    HPC_PARAM_DISPATCH_NS = 6,  /* cost of a call per extra pool thread, measured at create; since 1.1 */
+};
+
+/* threads <= 0: one per online CPU. NULL if the pool cannot be started. */
+HPC_API hpc_ctx_t *hpc_ctx_create(int threads, unsigned flags);
+HPC_API void hpc_ctx_destroy(hpc_ctx_t *ctx);
+/* Value of an HPC_PARAM_* key; HPC_EINVAL for an unknown one */
+HPC_API int hpc_ctx_param(const hpc_ctx_t *ctx, int param);
+
+HPC_API int hpc_add(hpc_ctx_t *ctx, int pattern, int m, int n,
+                    const double *A, int lda, const double *B, int ldb, double *C, int ldc);
+HPC_API int hpc_gemv(hpc_ctx_t *ctx, int pattern, int m, int n,
+                     const double *A, int lda, const double *x, double *y);
+HPC_API int hpc_gemm(hpc_ctx_t *ctx, int method, int m, int n, int k,
+                     const double *A, int lda, const double *B, int ldb, double *C, int ldc);
+/* C += A B, for callers that sum partial products (SUMMA panels); since 1.1 */
+HPC_API int hpc_gemm_acc(hpc_ctx_t *ctx, int method, int m, int n, int k,
+                         const double *A, int lda, const double *B, int ldb, double *C, int ldc);
+
+/* Run fn(arg, tid, nthreads) on pool threads 0..nthreads-1, the caller
+ * being thread 0; nthreads <= 0 or above the pool size means the whole
+ * pool. No cutoff: fn splits the work itself. Since 1.1. */
+HPC_API int hpc_parallel(hpc_ctx_t *ctx, void (*fn)(void *arg, int tid, int nthreads), void *arg,
+                         int nthreads);
+
+HPC_API const char *hpc_strerror(int code);
+/* Major * 100 + minor of the library actually loaded */
+HPC_API int hpcmat_version(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif